@@ -0,0 +1,125 @@
+// ConcurrentHashMap under several threads.
+// First a correctness check: threads insert, read and remove disjoint key
+// ranges at the same time, then every key is verified. Then throughput of a
+// 99% get / 1% insert-or-remove mix from 1 thread up to the hardware
+// thread count (at least 4), on as many keys as the large actor table.
+// Usage: bench/concurrent [threads]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "dst/concurrenthashmap.h"
+
+static const int KEYS = 300000;
+static const int OPS_PER_THREAD = 2000000;
+
+// Keys spread like ids rather than packed 0..n
+static int keyAt(int i) {
+    return i * 4099 + 13;
+}
+
+// xorshift, cheap enough not to show up next to a map operation
+static unsigned nextRandom(unsigned& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Each thread owns keys i with i % threads == thread: it inserts them all,
+// reads them back while the others are still writing, then removes every
+// other one. Returns the number of wrong results seen
+static long check(int threads) {
+    ConcurrentHashMap<int, int> map;
+    std::atomic<long> errors(0);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([&map, &errors, t, threads]() {
+            long wrong = 0;
+            for(int i = t; i < KEYS; i += threads) map.insert(keyAt(i), i);
+            for(int i = t; i < KEYS; i += threads) {
+                int value = -1;
+                if(!map.get(keyAt(i), value) || value != i) wrong++;
+            }
+            for(int i = t; i < KEYS; i += 2 * threads) {
+                if(!map.remove(keyAt(i))) wrong++;
+            }
+            errors += wrong;
+        });
+    }
+    for(std::thread& worker : workers) worker.join();
+
+    // Single-threaded view of the result
+    long wrong = errors.load();
+    int expected = 0;
+    for(int t = 0; t < threads; t++) {
+        for(int i = t; i < KEYS; i += threads) {
+            bool removed = (i - t) % (2 * threads) == 0;
+            int value = -1;
+            bool found = map.get(keyAt(i), value);
+            if(found == removed || (found && value != i)) wrong++;
+            expected += !removed;
+        }
+    }
+    if(map.getSize() != expected) wrong++;
+    return wrong;
+}
+
+// Million operations per second over all threads
+static double throughput(ConcurrentHashMap<int, int>& map, int threads) {
+    std::atomic<long> hits(0);
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([&map, &hits, t]() {
+            unsigned state = 2463534242u + t;
+            long found = 0;
+            int value;
+            for(int op = 0; op < OPS_PER_THREAD; op++) {
+                unsigned r = nextRandom(state);
+                int i = static_cast<int>(r % KEYS);
+                if(r % 100 != 0) {
+                    found += map.get(keyAt(i), value);
+                }
+                else if(r & 0x100) {
+                    map.insert(keyAt(i), i);
+                }
+                else {
+                    map.remove(keyAt(i));
+                }
+            }
+            hits += found;
+        });
+    }
+    for(std::thread& worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(threads) * OPS_PER_THREAD / seconds / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    int hardware = static_cast<int>(std::thread::hardware_concurrency());
+    int maxThreads = argc > 1 ? atoi(argv[1]) : std::max(hardware, 4);
+
+    long errors = 0;
+    for(int threads = 1; threads <= maxThreads; threads *= 2) {
+        long wrong = check(threads);
+        printf("check, %d threads: %s\n", threads, wrong ? "FAILED" : "ok");
+        errors += wrong;
+    }
+
+    ConcurrentHashMap<int, int> map;
+    for(int i = 0; i < KEYS; i++) map.insert(keyAt(i), i);
+
+    printf("99%% get / 1%% insert or remove, %d keys, %d shards, %d hardware threads\n", KEYS, map.shardCount(), hardware);
+    double single = 0;
+    for(int threads = 1; threads <= maxThreads; threads *= 2) {
+        double rate = throughput(map, threads);
+        if(threads == 1) single = rate;
+        printf("  %2d threads %8.1f Mops/s  %.2fx\n", threads, rate, rate / single);
+    }
+    return errors ? 1 : 0;
+}
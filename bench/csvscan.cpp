@@ -0,0 +1,93 @@
+// Times the findSpecial kernels over the large CSV files and checks that
+// every kernel stops at the same positions as the scalar loop.
+// Usage: bench/csvscan [file...], defaults to data/*-large.csv
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "utils/csvparser.h"
+#include "utils/csvscan.h"
+
+using namespace CSVParser;
+
+typedef const char* (*ScanKernel)(const char*, const char*);
+
+static const int ROUNDS = 5;
+
+// Offsets of every special character in [begin, end), as found by kernel
+static void scan(ScanKernel kernel, const char* begin, const char* end, std::vector<size_t>& positions) {
+    positions.clear();
+    const char* p = begin;
+    while((p = kernel(p, end)) < end) {
+        positions.push_back(static_cast<size_t>(p - begin));
+        p++;
+    }
+}
+
+// Best of ROUNDS full scans, in seconds
+static double timeKernel(ScanKernel kernel, const char* begin, const char* end, std::vector<size_t>& positions) {
+    double best = 0;
+    for(int round = 0; round < ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        scan(kernel, begin, end, positions);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(round == 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    const char* defaults[] = {"data/actors-large.csv", "data/movies-large.csv", "data/cast-large.csv"};
+    const char** files = argc > 1 ? const_cast<const char**>(argv + 1) : defaults;
+    int fileCount = argc > 1 ? argc - 1 : 3;
+
+    struct Kernel {
+        const char* name;
+        ScanKernel scan;
+        bool supported;
+    };
+    bool avx2 = true;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+    Kernel kernels[] = {
+        {"scalar", detail::findSpecialScalar, true},
+        {"sse2", detail::findSpecialSSE2, true},
+        {"avx2", detail::findSpecialAVX2, avx2},
+    };
+
+    printf("findSpecial dispatches to %s\n", detail::scanKernelName());
+    bool ok = true;
+    for(int f = 0; f < fileCount; f++) {
+        detail::MappedFile file;
+        try {
+            detail::mapFile(files[f], file);
+        } catch(const char* error) {
+            printf("%s: %s, skipped\n", files[f], error);
+            continue;
+        }
+        const char* begin = file.data;
+        const char* end = file.data + file.size;
+        double megabytes = file.size / (1024.0 * 1024.0);
+
+        std::vector<size_t> expected, positions;
+        double scalar = timeKernel(kernels[0].scan, begin, end, expected);
+        printf("%s: %.1f MiB, %zu special characters\n", files[f], megabytes, expected.size());
+        printf("  %-6s %8.2f ms %8.0f MiB/s\n", kernels[0].name, scalar * 1000, megabytes / scalar);
+
+        for(int k = 1; k < 3; k++) {
+            if(!kernels[k].supported) {
+                printf("  %-6s not supported by this CPU\n", kernels[k].name);
+                continue;
+            }
+            double seconds = timeKernel(kernels[k].scan, begin, end, positions);
+            bool same = positions == expected;
+            ok = ok && same;
+            printf("  %-6s %8.2f ms %8.0f MiB/s  %.1fx%s\n", kernels[k].name, seconds * 1000, megabytes / seconds,
+                   scalar / seconds, same ? "" : "  POSITIONS DIFFER");
+        }
+        detail::unmapFile(file);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// FlatHashMap against the chained HashMap on the id -> table index maps the
+// app builds: every actor and movie id of the large CSVs is inserted, looked
+// up in random order, looked up with ids that are not present, and removed.
+// Usage: bench/hashmaps [actors.csv movies.csv]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "classes/actor.h"
+#include "classes/movie.h"
+#include "dst/flathashmap.h"
+#include "dst/hashmap.h"
+
+static const int ROUNDS = 3;
+
+struct Timings {
+    double insert, hit, miss, remove; // best ns per operation
+};
+
+static double nsPerOp(std::chrono::steady_clock::time_point start, size_t ops) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+}
+
+static void keepBest(double& best, double ns, int round) {
+    if(round == 0 || ns < best) best = ns;
+}
+
+template<typename Map>
+static Timings run(const std::vector<int>& keys, const std::vector<int>& lookups, const std::vector<int>& missing) {
+    Timings best = Timings();
+    long found = 0;
+    for(int round = 0; round < ROUNDS; round++) {
+        Map map;
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < keys.size(); i++) map.insert(keys[i], static_cast<int>(i));
+        keepBest(best.insert, nsPerOp(start, keys.size()), round);
+
+        start = std::chrono::steady_clock::now();
+        for(int key : lookups) found += map.get(key) != nullptr;
+        keepBest(best.hit, nsPerOp(start, lookups.size()), round);
+
+        start = std::chrono::steady_clock::now();
+        for(int key : missing) found += map.get(key) != nullptr;
+        keepBest(best.miss, nsPerOp(start, missing.size()), round);
+
+        start = std::chrono::steady_clock::now();
+        for(int key : lookups) found -= map.remove(key);
+        keepBest(best.remove, nsPerOp(start, lookups.size()), round);
+    }
+    // Every hit was removed again and no miss was found
+    if(found != 0) printf("  lookups disagree with removes\n");
+    return best;
+}
+
+static void report(const char* name, const Timings& t) {
+    printf("  %-12s insert %6.1f  hit %6.1f  miss %6.1f  remove %6.1f  ns/op\n", name, t.insert, t.hit, t.miss, t.remove);
+}
+
+static void compare(const char* label, const std::vector<int>& keys) {
+    if(keys.empty()) return;
+
+    // Hits in random order, misses shifted past the largest id
+    std::vector<int> lookups(keys);
+    std::shuffle(lookups.begin(), lookups.end(), std::mt19937(42));
+    int largest = *std::max_element(keys.begin(), keys.end());
+    std::vector<int> missing(lookups);
+    for(int& key : missing) key += largest + 1;
+
+    printf("%s: %zu keys\n", label, keys.size());
+    report("HashMap", run<HashMap<int, int>>(keys, lookups, missing));
+    report("FlatHashMap", run<FlatHashMap<int, int>>(keys, lookups, missing));
+}
+
+// Ids of every row, in file order
+template<typename T>
+static std::vector<int> loadIds(const char* filename) {
+    CSVParser::Options options;
+    options.columns = 1u << CSVParser::Traits<T>::ID;
+    size_t count = 0;
+    std::vector<int> ids;
+    try {
+        T* rows = CSVParser::ParseMapped<T>(filename, &count, options);
+        for(size_t i = 0; i < count; i++) ids.push_back(rows[i].id);
+        CSVParser::FreeResults<T>(rows, count, options);
+    } catch(const char* error) {
+        printf("%s: %s, skipped\n", filename, error);
+    }
+    return ids;
+}
+
+int main(int argc, char* argv[]) {
+    compare("actor ids", loadIds<Actor>(argc > 1 ? argv[1] : "data/actors-large.csv"));
+    compare("movie ids", loadIds<Movie>(argc > 2 ? argv[2] : "data/movies-large.csv"));
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Per-operation latency percentiles on the actor ids of the large CSV:
+//  - lookups in the mutable FlatHashMap the id map used to be, in the
+//    FrozenHashMap right after freeze(), with admin-style edits sitting in
+//    its overlay, and after refreeze()
+//  - inserts into a HashMap resizing all at once and incrementally
+// Every operation is timed on its own, minus the cost of reading the clock.
+// Usage: bench/latency [actors.csv]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "classes/actor.h"
+#include "dst/flathashmap.h"
+#include "dst/frozenhashmap.h"
+#include "dst/hashmap.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double clockOverhead = 0;
+
+static double nanoseconds(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// Median of back-to-back clock reads
+static double measureClockOverhead() {
+    std::vector<double> samples(100000);
+    for(double& sample : samples) {
+        Clock::time_point start = Clock::now();
+        sample = nanoseconds(start, Clock::now());
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+static double percentile(std::vector<double>& samples, double p) {
+    size_t index = static_cast<size_t>(p / 100 * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+static void report(const char* label, std::vector<double>& samples) {
+    double p50 = percentile(samples, 50);
+    double p99 = percentile(samples, 99);
+    double p999 = percentile(samples, 99.9);
+    double worst = *std::max_element(samples.begin(), samples.end());
+    printf("  %-36s p50 %7.0f  p99 %7.0f  p99.9 %8.0f  max %10.0f ns\n", label, p50, p99, p999, worst);
+}
+
+// Time every lookup of keys on its own
+template<typename Map>
+static void lookups(const char* label, Map& map, const std::vector<int>& keys) {
+    std::vector<double> samples(keys.size());
+    long missing = 0;
+    for(size_t i = 0; i < keys.size(); i++) {
+        Clock::time_point start = Clock::now();
+        int* value = map.get(keys[i]);
+        Clock::time_point end = Clock::now();
+        missing += value == nullptr;
+        samples[i] = std::max(0.0, nanoseconds(start, end) - clockOverhead);
+    }
+    if(missing) printf("  %s: %ld keys missing\n", label, missing);
+    report(label, samples);
+}
+
+template<typename Map>
+static void inserts(const char* label, Map& map, const std::vector<int>& keys) {
+    std::vector<double> samples(keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        Clock::time_point start = Clock::now();
+        map.insert(keys[i], static_cast<int>(i));
+        Clock::time_point end = Clock::now();
+        samples[i] = std::max(0.0, nanoseconds(start, end) - clockOverhead);
+    }
+    report(label, samples);
+}
+
+int main(int argc, char* argv[]) {
+    const char* filename = argc > 1 ? argv[1] : "data/actors-large.csv";
+    CSVParser::Options options;
+    options.columns = 1u << CSVParser::Traits<Actor>::ID;
+    size_t count = 0;
+    Actor* rows;
+    try {
+        rows = CSVParser::ParseMapped<Actor>(filename, &count, options);
+    } catch(const char* error) {
+        printf("%s: %s, skipped\n", filename, error);
+        return 0;
+    }
+
+    // id -> table index, as built on load
+    std::vector<int> ids(count), indices(count);
+    for(size_t i = 0; i < count; i++) {
+        ids[i] = rows[i].id;
+        indices[i] = static_cast<int>(i);
+    }
+    CSVParser::FreeResults<Actor>(rows, count, options);
+    int largest = *std::max_element(ids.begin(), ids.end());
+
+    clockOverhead = measureClockOverhead();
+    printf("%s: %zu actor ids, clock read %.0f ns subtracted\n", filename, count, clockOverhead);
+
+    std::mt19937 random(42);
+    std::vector<int> shuffled(ids);
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+
+    printf("lookups, every key once in random order\n");
+    FlatHashMap<int, int> flat(static_cast<int>(count));
+    for(size_t i = 0; i < count; i++) flat.insert(ids[i], indices[i]);
+    lookups("FlatHashMap (before freeze)", flat, shuffled);
+
+    FrozenHashMap<int, int> frozen(ids.data(), indices.data(), static_cast<int>(count));
+    lookups("FrozenHashMap, frozen", frozen, shuffled);
+
+    // Admin edits below the refreeze threshold: new actors and removed ones
+    // stay in the overlay, so lookups check it before the frozen slots
+    size_t added = count / 20, removed = count / 40;
+    std::vector<int> live(shuffled.begin() + removed, shuffled.end());
+    for(size_t i = 0; i < removed; i++) frozen.remove(shuffled[i]);
+    for(size_t i = 0; i < added; i++) {
+        frozen.insert(largest + 1 + static_cast<int>(i), static_cast<int>(count + i));
+        live.push_back(largest + 1 + static_cast<int>(i));
+    }
+    std::shuffle(live.begin(), live.end(), random);
+    printf("  (%zu inserts and %zu removes applied, %d overlay entries)\n", added, removed, frozen.deltaSize());
+    lookups("FrozenHashMap, with delta edits", frozen, live);
+
+    frozen.refreeze();
+    lookups("FrozenHashMap, refrozen", frozen, live);
+
+    printf("inserts, from an empty map\n");
+    HashMap<int, int> stopTheWorld;
+    inserts("HashMap, full resize", stopTheWorld, ids);
+    HashMap<int, int> incremental(16, true);
+    inserts("HashMap, incremental resize", incremental, ids);
+    return 0;
+}
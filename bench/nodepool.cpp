@@ -0,0 +1,94 @@
+// LinkedList with one heap allocation per node against nodes from a NodePool,
+// on the cast relations of the large CSV: one list of movies per actor,
+// filled in file order the way the app built its adjacency lists before the
+// cast graph. Times building them (startup), walking every list (traversal),
+// removing and re-adding one node per list (churn) and destroying them.
+// "own" is the default allocator, a pool per list; "shared" is one pool for
+// all the lists, the way HashMap hands one to its chains.
+// Usage: bench/nodepool [cast.csv]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "classes/actor-movie.h"
+#include "dst/linkedlist.h"
+
+static const int TRAVERSALS = 5;
+
+static double secondsSince(std::chrono::steady_clock::time_point& start) {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - start).count();
+    start = now;
+    return seconds;
+}
+
+// pool is destroyed with the lists, nullptr when the lists own their nodes
+template<typename Alloc>
+static void run(const char* name, const std::vector<ActorMovie>& rows, int actors, const Alloc& alloc, NodePool* pool) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<LinkedList<int, Alloc>> lists;
+    lists.reserve(actors);
+    for(int i = 0; i < actors; i++) lists.emplace_back(alloc);
+    for(const ActorMovie& row : rows) lists[row.actor_id].push_back(row.movie_id);
+    double build = secondsSince(start);
+
+    long sum = 0;
+    for(int round = 0; round < TRAVERSALS; round++) {
+        for(LinkedList<int, Alloc>& list : lists) {
+            for(int movie : list) sum += movie;
+        }
+    }
+    double traverse = secondsSince(start);
+
+    for(LinkedList<int, Alloc>& list : lists) {
+        if(!list.empty()) {
+            int movie = list.front();
+            list.pop_front();
+            list.push_back(movie);
+        }
+    }
+    double churn = secondsSince(start);
+
+    lists.clear();
+    lists.shrink_to_fit();
+    delete pool;
+    double teardown = secondsSince(start);
+
+    double nodes = static_cast<double>(rows.size()) * TRAVERSALS;
+    printf("  %-6s build %7.1f ms  traverse %6.1f Mnodes/s  churn %6.1f ms  teardown %6.1f ms  (%ld)\n", name,
+           build * 1000, nodes / traverse / 1e6, churn * 1000, teardown * 1000, sum);
+}
+
+int main(int argc, char* argv[]) {
+    const char* filename = argc > 1 ? argv[1] : "data/cast-large.csv";
+    size_t count = 0;
+    ActorMovie* parsed;
+    try {
+        parsed = CSVParser::ParseMapped<ActorMovie>(filename, &count);
+    } catch(const char* error) {
+        printf("%s: %s, skipped\n", filename, error);
+        return 0;
+    }
+
+    // Dense actor numbers stand in for table indices
+    std::vector<int> ids;
+    for(size_t i = 0; i < count; i++) ids.push_back(parsed[i].actor_id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    std::vector<ActorMovie> rows(parsed, parsed + count);
+    for(ActorMovie& row : rows) {
+        row.actor_id = static_cast<int>(std::lower_bound(ids.begin(), ids.end(), row.actor_id) - ids.begin());
+    }
+    CSVParser::FreeResults<ActorMovie>(parsed, count);
+
+    int actors = static_cast<int>(ids.size());
+    printf("%s: %zu cast rows over %d actors\n", filename, count, actors);
+    for(int repeat = 0; repeat < 2; repeat++) {
+        run("heap", rows, actors, HeapAllocator(), nullptr);
+        run("own", rows, actors, OwnPoolAllocator(), nullptr);
+        NodePool* pool = new NodePool(LinkedList<int, PoolAllocator>::nodeBytes());
+        run("shared", rows, actors, PoolAllocator(pool), pool);
+    }
+    return 0;
+}
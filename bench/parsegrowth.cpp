@@ -0,0 +1,101 @@
+// Realloc traffic of CSVParser::Parse's results array on the large CSV
+// files, against the old growth of one realloc per row.
+// Every realloc in the process goes through the counter below (glibc only).
+// Usage: bench/parsegrowth [actors.csv movies.csv cast.csv]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+
+#include "classes/actor.h"
+#include "classes/movie.h"
+#include "classes/actor-movie.h"
+
+extern "C" void* __libc_realloc(void* memory, size_t bytes);
+
+// parseLine grows its column arrays with realloc too; those stay far below
+// this size, so only results arrays are counted
+static const size_t RESULTS_MIN_BYTES = 256;
+
+static size_t reallocCalls = 0;
+static size_t bytesCopied = 0;
+
+extern "C" void* realloc(void* memory, size_t bytes) {
+    size_t old = memory ? malloc_usable_size(memory) : 0;
+    void* moved = __libc_realloc(memory, bytes);
+    if(bytes >= RESULTS_MIN_BYTES) {
+        reallocCalls++;
+        if(memory && moved != memory) bytesCopied += old < bytes ? old : bytes;
+    }
+    return moved;
+}
+
+struct Traffic {
+    size_t calls;
+    size_t copied;
+    double seconds;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The old Parse: realloc(results, (count + 1) * sizeof(T)) for every row
+template<typename T>
+static Traffic perRowGrowth(size_t rows) {
+    size_t calls = 0, copied = 0;
+    auto start = std::chrono::steady_clock::now();
+    T* results = nullptr;
+    for(size_t count = 0; count < rows; count++) {
+        size_t old = results ? malloc_usable_size(results) : 0;
+        T* grown = static_cast<T*>(__libc_realloc(results, (count + 1) * sizeof(T)));
+        calls++;
+        if(results && grown != results) copied += old;
+        results = grown;
+        results[count] = T();
+    }
+    double seconds = secondsSince(start);
+    free(results);
+    return Traffic{calls, copied, seconds};
+}
+
+template<typename T>
+static Traffic parse(const char* filename, size_t& rows, size_t capacityHint) {
+    reallocCalls = bytesCopied = 0;
+    auto start = std::chrono::steady_clock::now();
+    T* results = CSVParser::Parse<T>(filename, &rows, capacityHint);
+    double seconds = secondsSince(start);
+    Traffic traffic{reallocCalls, bytesCopied, seconds};
+    CSVParser::FreeResults<T>(results, rows);
+    return traffic;
+}
+
+static void report(const char* label, const Traffic& traffic) {
+    printf("  %-28s %9zu reallocs %10.1f MiB copied %8.1f ms\n", label, traffic.calls,
+           traffic.copied / (1024.0 * 1024.0), traffic.seconds * 1000);
+}
+
+template<typename T>
+static void run(const char* filename) {
+    size_t rows = 0;
+    Traffic estimated;
+    try {
+        estimated = parse<T>(filename, rows, 0);
+    } catch(const char* error) {
+        printf("%s: %s, skipped\n", filename, error);
+        return;
+    }
+    Traffic hinted = parse<T>(filename, rows, rows);
+
+    printf("%s: %zu rows of %zu bytes\n", filename, rows, sizeof(T));
+    report("one realloc per row (old)", perRowGrowth<T>(rows));
+    report("Parse, estimated row count", estimated);
+    report("Parse, exact capacity hint", hinted);
+}
+
+int main(int argc, char* argv[]) {
+    run<Actor>(argc > 1 ? argv[1] : "data/actors-large.csv");
+    run<Movie>(argc > 2 ? argv[2] : "data/movies-large.csv");
+    run<ActorMovie>(argc > 3 ? argv[3] : "data/cast-large.csv");
+    return 0;
+}
@@ -0,0 +1,121 @@
+#ifndef SORTED_SET_H
+#define SORTED_SET_H
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// Set operations on ascending int arrays, such as cast graph rows.
+
+// First element >= value. Probes 1, 2, 4, ... elements ahead before the
+// binary search, so finding a value near the front costs O(log distance)
+inline const int* gallop_lower_bound(const int* first, const int* last, int value) {
+    int step = 1;
+    const int* low = first;
+    const int* high = first;
+    while(high < last && *high < value) {
+        low = high + 1;
+        high = (last - high > step) ? high + step : last;
+        step *= 2;
+    }
+
+    // Answer lies in [low, high]
+    while(low < high) {
+        const int* mid = low + (high - low) / 2;
+        if(*mid < value) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+inline bool sorted_contains(const int* first, const int* last, int value) {
+    // Binary search for the first element >= value
+    const int* low = first;
+    const int* high = last;
+    while(low < high) {
+        const int* mid = low + (high - low) / 2;
+        if(*mid < value) low = mid + 1;
+        else high = mid;
+    }
+    return low != last && *low == value;
+}
+
+// Append value unless it repeats the last output, keeping results distinct
+inline void append_distinct(int* out, int& count, int value) {
+    if(count == 0 || out[count - 1] != value) out[count++] = value;
+}
+
+inline int intersect_merge(const int* a, int aSize, const int* b, int bSize, int* out, int count) {
+    int i = 0, j = 0;
+    while(i < aSize && j < bSize) {
+        if(a[i] < b[j]) i++;
+        else if(b[j] < a[i]) j++;
+        else {
+            append_distinct(out, count, a[i]);
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+// Far smaller a: look each of its values up in b instead of walking b
+inline int intersect_gallop(const int* a, int aSize, const int* b, int bSize, int* out) {
+    int count = 0;
+    const int* from = b;
+    const int* last = b + bSize;
+    for(int i = 0; i < aSize && from < last; i++) {
+        from = gallop_lower_bound(from, last, a[i]);
+        if(from < last && *from == a[i]) append_distinct(out, count, a[i]);
+    }
+    return count;
+}
+
+#if defined(__SSE2__)
+// Compares blocks of four: each value of an a block against every value
+// of a b block (four rotations), then advances whichever block ends lower.
+// Any value left behind in that block is below everything still ahead in
+// the other array, or equal to a value already compared against it
+inline int intersect_sse2(const int* a, int aSize, const int* b, int bSize, int* out) {
+    int count = 0;
+    int i = 0, j = 0;
+    while(i + 4 <= aSize && j + 4 <= bSize) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i equal = _mm_cmpeq_epi32(va, vb);
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        while(mask) {
+            append_distinct(out, count, a[i + __builtin_ctz(mask)]);
+            mask &= mask - 1;
+        }
+
+        int aLast = a[i + 3];
+        int bLast = b[j + 3];
+        if(aLast <= bLast) i += 4;
+        if(bLast <= aLast) j += 4;
+    }
+    return intersect_merge(a + i, aSize - i, b + j, bSize - j, out, count);
+}
+#endif
+
+// Distinct values present in both arrays, written ascending to out, which
+// needs room for the smaller array. Returns how many were written
+inline int sorted_intersect(const int* a, int aSize, const int* b, int bSize, int* out) {
+    if(aSize > bSize) return sorted_intersect(b, bSize, a, aSize, out);
+    if(aSize == 0) return 0;
+
+    // Galloping wins once b is much longer than a
+    if(bSize / aSize >= 32) return intersect_gallop(a, aSize, b, bSize, out);
+
+#if defined(__SSE2__)
+    return intersect_sse2(a, aSize, b, bSize, out);
+#else
+    return intersect_merge(a, aSize, b, bSize, out, 0);
+#endif
+}
+
+#endif // SORTED_SET_H
@@ -14,13 +14,24 @@ namespace CSVParser
     template <>
     struct Traits<ActorMovie>
     {
-        static void apply(ActorMovie &obj, char **cols, int &idx)
+        static const int columns = 2;
+        static const bool numeric = true;
+
+        template <typename Col>
+        static void apply(ActorMovie &obj, Col *cols, int &idx, const Options &)
         {
             obj.actor_id = detail::convertInt(cols[idx++]);
             obj.movie_id = detail::convertInt(cols[idx++]);
         }
 
-        static void free(ActorMovie &obj)
+        // Fast path used when both columns are plain integers
+        static void applyInts(ActorMovie &obj, const int *values)
+        {
+            obj.actor_id = values[0];
+            obj.movie_id = values[1];
+        }
+
+        static void free(ActorMovie &)
         {
         }
     };
@@ -2,21 +2,24 @@
 #define ACTOR_H
 
 #include "utils/csvparser.h"
-#include "dst/linkedlist.h"
 
 struct Actor {
     int id;
     char* name;
     int year;
-    LinkedList<int>* movies;
 };
 
 namespace CSVParser {
     template<>
     struct Traits<Actor> {
-        static void apply(Actor& obj, char** cols, int& idx) {
+        static const int columns = 3;
+        enum Column { ID, NAME, YEAR };
+
+        template<typename Col>
+        static void apply(Actor& obj, Col* cols, int& idx, const Options& options) {
             obj.id = detail::convertInt(cols[idx++]);
-            obj.name = detail::convertString(cols[idx++]);
+            obj.name = options.load(NAME) ? detail::convertString(cols[idx], options.arena) : nullptr;
+            idx++;
             obj.year = detail::convertInt(cols[idx++]);
         }
         
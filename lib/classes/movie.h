@@ -2,29 +2,32 @@
 #define MOVIE_H
 
 #include "utils/csvparser.h"
-#include "dst/linkedlist.h"
 
 struct Movie {
     int id;
     char* title;
-    char* plot;
+    CSVParser::LazyString plot; // cold column, read through CSVParser::Fetch
     int year;
-    LinkedList<int>* actors;
 };
 
 namespace CSVParser {
     template<>
     struct Traits<Movie> {
-        static void apply(Movie& obj, char** cols, int& idx) {
+        static const int columns = 4;
+        enum Column { ID, TITLE, PLOT, YEAR };
+
+        template<typename Col>
+        static void apply(Movie& obj, Col* cols, int& idx, const Options& options) {
             obj.id = detail::convertInt(cols[idx++]);
-            obj.title = detail::convertString(cols[idx++]);
-            obj.plot = detail::convertString(cols[idx++]);
+            obj.title = options.load(TITLE) ? detail::convertString(cols[idx], options.arena) : nullptr;
+            idx++;
+            obj.plot = detail::convertLazy(cols[idx++], options, PLOT);
             obj.year = detail::convertInt(cols[idx++]);
         }
         
         static void free(Movie& obj) {
             ::free(obj.title);
-            ::free(obj.plot);
+            ::free(obj.plot.value);
         }
     };
 }
@@ -0,0 +1,429 @@
+#ifndef BIPARTITEGRAPH_H
+#define BIPARTITEGRAPH_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "algs/sortedset.h"
+#include "dst/flathashmap.h"
+#include "dst/smallvector.h"
+
+// Bipartite graph between left and right vertices numbered from 0, stored in
+// compressed sparse row form in both directions: the neighbours of every
+// vertex sit contiguously in one array, found through an offset array, so a
+// traversal is a linear scan rather than a chase through list nodes.
+//
+// The CSR arrays are built once, in two passes over the edges (count, then
+// fill), or adopted from existing arrays such as a snapshot mapping. Later
+// edits copy the touched vertex's neighbours into a delta row and change
+// that; once enough rows are in the delta, everything is compacted back into
+// fresh CSR arrays. Edges may repeat, and removing one removes one copy.
+//
+// Every vertex's neighbours are kept in ascending order, so membership is a
+// binary search and two vertices' neighbours intersect in one merge.
+class BipartiteGraph
+{
+public:
+    enum Side
+    {
+        LEFT,
+        RIGHT
+    };
+
+    // Neighbours of one vertex, valid until the next edit of the graph
+    struct Range
+    {
+        const int *first;
+        const int *last;
+
+        const int *begin() const { return first; }
+        const int *end() const { return last; }
+        int size() const { return static_cast<int>(last - first); }
+        bool empty() const { return first == last; }
+
+        bool contains(int vertex) const
+        {
+            return sorted_contains(first, last, vertex);
+        }
+    };
+
+private:
+    // Edited neighbour list of one vertex, most fit inline
+    typedef SmallVector<int, 8> Row;
+
+    // One direction of the graph
+    struct Adjacency
+    {
+        int count;                // vertices on this side
+        int compacted;            // vertices covered by offsets
+        uint64_t *offsets;        // compacted + 1 entries into neighbours
+        int *neighbours;
+        int *cursors;             // fill position per vertex while building
+        FlatHashMap<int, Row> rows; // delta rows, override the CSR range
+    };
+
+    // Compact once this many rows (both sides together) are in the delta
+    static const int COMPACT_DIVISOR = 64;
+    static const int COMPACT_MIN = 256;
+
+    Adjacency sides[2];
+    bool owned; // CSR arrays were allocated here, not adopted
+    size_t edges;
+
+    Range csr(const Adjacency &side, int vertex) const
+    {
+        if (vertex >= side.compacted)
+        {
+            return Range{nullptr, nullptr};
+        }
+        return Range{side.neighbours + side.offsets[vertex], side.neighbours + side.offsets[vertex + 1]};
+    }
+
+    // Delta row of a vertex, created from its CSR range on first edit
+    Row &row(Adjacency &side, int vertex)
+    {
+        std::pair<Row *, bool> found = side.rows.try_emplace(vertex);
+        Row &edited = *found.first;
+        if (found.second)
+        {
+            Range current = csr(side, vertex);
+            edited.reserve(current.size() + 1);
+            for (int neighbour : current)
+            {
+                edited.push_back(neighbour);
+            }
+        }
+        return edited;
+    }
+
+    // Add vertex to a sorted row, after any equal copies
+    static void insertSorted(Row &target, int vertex)
+    {
+        const int *position = gallop_lower_bound(target.begin(), target.end(), vertex + 1);
+        target.insert(static_cast<int>(position - target.begin()), vertex);
+    }
+
+    // Remove one copy of vertex from a sorted row
+    static bool eraseSorted(Row &target, int vertex)
+    {
+        const int *position = gallop_lower_bound(target.begin(), target.end(), vertex);
+        if (position == target.end() || *position != vertex)
+        {
+            return false;
+        }
+        target.erase(static_cast<int>(position - target.begin()));
+        return true;
+    }
+
+    // Rewrite to's neighbours from from's, visiting from's vertices in
+    // ascending order, so every row of to comes out sorted
+    static void transpose(const Adjacency &from, Adjacency &to)
+    {
+        for (int v = 0; v < to.count; ++v)
+        {
+            to.cursors[v] = 0;
+        }
+        for (int v = 0; v < from.count; ++v)
+        {
+            for (uint64_t e = from.offsets[v]; e < from.offsets[v + 1]; ++e)
+            {
+                int u = from.neighbours[e];
+                to.neighbours[to.offsets[u] + to.cursors[u]++] = v;
+            }
+        }
+    }
+
+    void grow(Side side, int vertex)
+    {
+        if (vertex >= sides[side].count)
+        {
+            sides[side].count = vertex + 1;
+        }
+    }
+
+    void releaseRows(Adjacency &side)
+    {
+        side.rows.clear();
+    }
+
+    void releaseArrays()
+    {
+        if (owned)
+        {
+            for (Adjacency &side : sides)
+            {
+                delete[] side.offsets;
+                delete[] side.neighbours;
+            }
+        }
+        for (Adjacency &side : sides)
+        {
+            side.offsets = nullptr;
+            side.neighbours = nullptr;
+            side.compacted = 0;
+            delete[] side.cursors;
+            side.cursors = nullptr;
+        }
+    }
+
+    void compactIfNeeded()
+    {
+        int edited = sides[LEFT].rows.getSize() + sides[RIGHT].rows.getSize();
+        if (edited > (sides[LEFT].count + sides[RIGHT].count) / COMPACT_DIVISOR + COMPACT_MIN)
+        {
+            compact();
+        }
+    }
+
+public:
+    // Constructor, empty graph
+    BipartiteGraph() : owned(false), edges(0)
+    {
+        for (Adjacency &side : sides)
+        {
+            side.count = 0;
+            side.compacted = 0;
+            side.offsets = nullptr;
+            side.neighbours = nullptr;
+            side.cursors = nullptr;
+        }
+    }
+
+    // Destructor
+    ~BipartiteGraph()
+    {
+        releaseArrays();
+        releaseRows(sides[LEFT]);
+        releaseRows(sides[RIGHT]);
+    }
+
+    BipartiteGraph(const BipartiteGraph &) = delete;
+    BipartiteGraph &operator=(const BipartiteGraph &) = delete;
+
+    // First build pass: drop all edges, then count_edge() every edge
+    void begin_count(int leftCount, int rightCount)
+    {
+        releaseArrays();
+        releaseRows(sides[LEFT]);
+        releaseRows(sides[RIGHT]);
+        sides[LEFT].count = leftCount;
+        sides[RIGHT].count = rightCount;
+        edges = 0;
+        owned = true;
+
+        // Offsets hold degrees until begin_fill()
+        for (Adjacency &side : sides)
+        {
+            side.compacted = side.count;
+            side.offsets = new uint64_t[side.count + 1]();
+        }
+    }
+
+    void count_edge(int left, int right)
+    {
+        ++sides[LEFT].offsets[left + 1];
+        ++sides[RIGHT].offsets[right + 1];
+        ++edges;
+    }
+
+    // Second build pass: turn degrees into offsets, then fill_edge() the same
+    // edges again, and end_fill()
+    void begin_fill()
+    {
+        for (Adjacency &side : sides)
+        {
+            uint64_t *offsets = side.offsets;
+            side.cursors = new int[side.count > 0 ? side.count : 1];
+            for (int v = 0; v < side.count; ++v)
+            {
+                offsets[v + 1] += offsets[v];
+                side.cursors[v] = 0;
+            }
+            side.neighbours = new int[edges > 0 ? edges : 1];
+        }
+    }
+
+    // Only the left side is filled from the edges, end_fill() derives the
+    // right side from it
+    void fill_edge(int left, int right)
+    {
+        Adjacency &l = sides[LEFT];
+        l.neighbours[l.offsets[left] + l.cursors[left]++] = right;
+    }
+
+    // Sort every row and release the build cursors. Transposing left to right
+    // and back is a counting sort of both sides, linear in the edges
+    void end_fill()
+    {
+        transpose(sides[LEFT], sides[RIGHT]);
+        transpose(sides[RIGHT], sides[LEFT]);
+        for (Adjacency &side : sides)
+        {
+            delete[] side.cursors;
+            side.cursors = nullptr;
+        }
+    }
+
+    // Use existing CSR arrays for both directions without copying. Rows must
+    // be sorted, and the arrays must outlive the graph's use of them, or its
+    // next compaction. They are only read, never written or freed
+    void adopt(int leftCount, const uint64_t *leftOffsets, const int *leftNeighbours,
+               int rightCount, const uint64_t *rightOffsets, const int *rightNeighbours)
+    {
+        releaseArrays();
+        releaseRows(sides[LEFT]);
+        releaseRows(sides[RIGHT]);
+        owned = false;
+
+        sides[LEFT].count = sides[LEFT].compacted = leftCount;
+        sides[LEFT].offsets = const_cast<uint64_t *>(leftOffsets);
+        sides[LEFT].neighbours = const_cast<int *>(leftNeighbours);
+        sides[RIGHT].count = sides[RIGHT].compacted = rightCount;
+        sides[RIGHT].offsets = const_cast<uint64_t *>(rightOffsets);
+        sides[RIGHT].neighbours = const_cast<int *>(rightNeighbours);
+        edges = leftOffsets[leftCount];
+    }
+
+    // Neighbours of a left vertex (right vertices) or of a right vertex
+    Range left(int vertex) const { return neighbours(LEFT, vertex); }
+    Range right(int vertex) const { return neighbours(RIGHT, vertex); }
+
+    Range neighbours(Side side, int vertex) const
+    {
+        const Row *edited = sides[side].rows.get(vertex);
+        if (edited != nullptr)
+        {
+            return Range{edited->begin(), edited->end()};
+        }
+        return csr(sides[side], vertex);
+    }
+
+    bool has_edge(int left, int right) const
+    {
+        // Search the shorter side
+        Range fromLeft = neighbours(LEFT, left);
+        Range fromRight = neighbours(RIGHT, right);
+        return fromLeft.size() <= fromRight.size() ? fromLeft.contains(right) : fromRight.contains(left);
+    }
+
+    void add_edge(int left, int right)
+    {
+        grow(LEFT, left);
+        grow(RIGHT, right);
+        insertSorted(row(sides[LEFT], left), right);
+        insertSorted(row(sides[RIGHT], right), left);
+        ++edges;
+        compactIfNeeded();
+    }
+
+    // Remove one copy of an edge, false if there is none
+    bool remove_edge(int left, int right)
+    {
+        if (!has_edge(left, right))
+        {
+            return false;
+        }
+        eraseSorted(row(sides[LEFT], left), right);
+        eraseSorted(row(sides[RIGHT], right), left);
+        --edges;
+        compactIfNeeded();
+        return true;
+    }
+
+    // Remove every edge of a vertex
+    void clear_vertex(Side side, int vertex)
+    {
+        Side other = side == LEFT ? RIGHT : LEFT;
+        Row &cleared = row(sides[side], vertex);
+        for (int neighbour : cleared)
+        {
+            eraseSorted(row(sides[other], neighbour), vertex);
+        }
+        edges -= cleared.getSize();
+        cleared.clear();
+        compactIfNeeded();
+    }
+
+    // Fold the delta rows back into fresh CSR arrays
+    void compact()
+    {
+        uint64_t *compactOffsets[2];
+        int *compactNeighbours[2];
+        for (int s = 0; s < 2; ++s)
+        {
+            Adjacency &side = sides[s];
+            compactOffsets[s] = new uint64_t[side.count + 1];
+            compactOffsets[s][0] = 0;
+            for (int v = 0; v < side.count; ++v)
+            {
+                compactOffsets[s][v + 1] = compactOffsets[s][v] + neighbours(static_cast<Side>(s), v).size();
+            }
+
+            compactNeighbours[s] = new int[compactOffsets[s][side.count] > 0 ? compactOffsets[s][side.count] : 1];
+            for (int v = 0; v < side.count; ++v)
+            {
+                Range current = neighbours(static_cast<Side>(s), v);
+                if (!current.empty())
+                {
+                    memcpy(compactNeighbours[s] + compactOffsets[s][v], current.first, current.size() * sizeof(int));
+                }
+            }
+        }
+
+        int counts[2] = {sides[LEFT].count, sides[RIGHT].count};
+        releaseArrays();
+        releaseRows(sides[LEFT]);
+        releaseRows(sides[RIGHT]);
+        owned = true;
+        for (int s = 0; s < 2; ++s)
+        {
+            sides[s].count = sides[s].compacted = counts[s];
+            sides[s].offsets = compactOffsets[s];
+            sides[s].neighbours = compactNeighbours[s];
+        }
+    }
+
+    // Neighbours shared by two vertices of one side, ascending and without
+    // repeats. out needs room for the smaller of the two rows
+    int common(Side side, int first, int second, int *out) const
+    {
+        Range a = neighbours(side, first);
+        Range b = neighbours(side, second);
+        return sorted_intersect(a.first, a.size(), b.first, b.size(), out);
+    }
+
+    // Vertices on one side, including ones only reached through edits
+    int vertexCount(Side side) const
+    {
+        return sides[side].count;
+    }
+
+    size_t edgeCount() const
+    {
+        return edges;
+    }
+
+    // Vertices whose neighbours are held in delta rows
+    int deltaRows() const
+    {
+        return sides[LEFT].rows.getSize() + sides[RIGHT].rows.getSize();
+    }
+
+    // Bytes held by the graph: CSR arrays (adopted ones included) and delta rows
+    size_t memory_usage() const
+    {
+        size_t bytes = sizeof(*this);
+        for (const Adjacency &side : sides)
+        {
+            if (side.offsets)
+            {
+                bytes += (side.compacted + 1) * sizeof(uint64_t) + side.offsets[side.compacted] * sizeof(int);
+            }
+            bytes += side.rows.memory_usage() - sizeof(side.rows);
+            side.rows.for_each([&](const int &, const Row &edited) { bytes += edited.heapBytes(); });
+        }
+        return bytes;
+    }
+};
+
+#endif // BIPARTITEGRAPH_H
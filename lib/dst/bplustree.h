@@ -2,6 +2,7 @@
 #define BPLUSTREE_H
 
 #include <cstring>
+#include <utility>
 
 // Forward declaration to allow template specialization for comparisons
 template <typename T>
@@ -41,56 +42,73 @@ private:
     // Minimum number of keys in a node
     static const int MIN_KEYS = (ORDER + 1) / 2 - 1;
 
-    // Node structure for B+ Tree
+    // Node structure for B+ Tree, the keys shared by both layouts
     struct Node
     {
         bool is_leaf;
         int key_count;
-        KeyType keys[MAX_KEYS + 1];      // +1 for easy splitting
-        Node *children[ORDER + 1];       // One more than max keys
-        ValueType *values[MAX_KEYS + 1]; // Only used in leaf nodes
-        Node *next_leaf;                 // Pointer to next leaf for range traversal
+        KeyType keys[MAX_KEYS + 1]; // +1 for easy splitting
 
-        Node() : is_leaf(false), key_count(0), next_leaf(nullptr)
+        Node(bool leaf) : is_leaf(leaf), key_count(0) {}
+    };
+
+    // Internal nodes only route to their children
+    struct InternalNode : Node
+    {
+        Node *children[ORDER + 1]; // One more than max keys
+
+        InternalNode() : Node(false)
         {
             for (int i = 0; i < ORDER + 1; ++i)
             {
                 children[i] = nullptr;
-                if (i < MAX_KEYS + 1)
-                {
-                    values[i] = nullptr;
-                }
             }
         }
+    };
 
-        ~Node()
-        {
-            // Free values in leaf nodes
-            if (is_leaf)
-            {
-                for (int i = 0; i < key_count; ++i)
-                {
-                    delete values[i];
-                }
-            }
-        }
+    // Values live in the leaves only, stored inline
+    struct LeafNode : Node
+    {
+        ValueType values[MAX_KEYS + 1];
+        LeafNode *next_leaf; // Pointer to next leaf for range traversal
+
+        LeafNode() : Node(true), next_leaf(nullptr) {}
     };
 
     Node *root;
 
     // Helper methods
+    static InternalNode *internal(Node *node)
+    {
+        return static_cast<InternalNode *>(node);
+    }
+
+    static LeafNode *leaf(Node *node)
+    {
+        return static_cast<LeafNode *>(node);
+    }
+
     Node *create_leaf_node()
     {
-        Node *node = new Node();
-        node->is_leaf = true;
-        return node;
+        return new LeafNode();
     }
 
     Node *create_internal_node()
     {
-        Node *node = new Node();
-        node->is_leaf = false;
-        return node;
+        return new InternalNode();
+    }
+
+    // Free a single node with the layout it was created with
+    static void free_node(Node *node)
+    {
+        if (node->is_leaf)
+        {
+            delete leaf(node);
+        }
+        else
+        {
+            delete internal(node);
+        }
     }
 
     // Split a full node during insertion
@@ -106,13 +124,12 @@ private:
 
             if (node->is_leaf)
             {
-                new_node->values[new_node->key_count] = node->values[i];
-                node->values[i] = nullptr;
+                leaf(new_node)->values[new_node->key_count] = std::move(leaf(node)->values[i]);
             }
             else
             {
-                new_node->children[new_node->key_count] = node->children[i];
-                node->children[i] = nullptr;
+                internal(new_node)->children[new_node->key_count] = internal(node)->children[i];
+                internal(node)->children[i] = nullptr;
             }
 
             new_node->key_count++;
@@ -121,8 +138,8 @@ private:
         // For internal nodes, move the middle key up
         if (!node->is_leaf)
         {
-            new_node->children[new_node->key_count] = node->children[node->key_count];
-            node->children[node->key_count] = nullptr;
+            internal(new_node)->children[new_node->key_count] = internal(node)->children[node->key_count];
+            internal(node)->children[node->key_count] = nullptr;
         }
 
         // Update original node's key count
@@ -131,57 +148,83 @@ private:
         // For leaf nodes, link leaves
         if (node->is_leaf)
         {
-            new_node->next_leaf = node->next_leaf;
-            node->next_leaf = new_node;
+            leaf(new_node)->next_leaf = leaf(node)->next_leaf;
+            leaf(node)->next_leaf = leaf(new_node);
         }
 
         return new_node;
     }
 
+    // Insert a key with its value, returns where the value is stored
+    ValueType *insert_value(const KeyType &key, ValueType &&value)
+    {
+        // If root is full, create new root
+        if (root->key_count == MAX_KEYS)
+        {
+            InternalNode *new_root = internal(create_internal_node());
+            Node *old_root = root;
+
+            root = new_root;
+            new_root->children[0] = old_root;
+
+            // Split the old root
+            Node *split_child = split_node(old_root);
+            new_root->keys[0] = split_child->keys[0];
+            new_root->children[1] = split_child;
+            new_root->key_count = 1;
+        }
+
+        return insert_non_full(root, key, std::move(value));
+    }
+
     // Recursive insertion
-    bool insert_non_full(Node *node, const KeyType &key, ValueType *value)
+    ValueType *insert_non_full(Node *node, const KeyType &key, ValueType &&value)
     {
         int i = node->key_count - 1;
 
         if (node->is_leaf)
         {
+            LeafNode *leaf_node = leaf(node);
+
             // Find insertion point in leaf
-            while (i >= 0 && Compare<KeyType>::less(key, node->keys[i]))
+            while (i >= 0 && Compare<KeyType>::less(key, leaf_node->keys[i]))
             {
-                node->keys[i + 1] = node->keys[i];
-                node->values[i + 1] = node->values[i];
+                leaf_node->keys[i + 1] = leaf_node->keys[i];
+                leaf_node->values[i + 1] = std::move(leaf_node->values[i]);
                 i--;
             }
 
             // Insert new key and value
-            node->keys[i + 1] = key;
-            node->values[i + 1] = value;
-            node->key_count++;
-            return true;
+            leaf_node->keys[i + 1] = key;
+            leaf_node->values[i + 1] = std::move(value);
+            leaf_node->key_count++;
+            return &leaf_node->values[i + 1];
         }
 
+        InternalNode *parent = internal(node);
+
         // Find child to recurse into
-        while (i >= 0 && Compare<KeyType>::less(key, node->keys[i]))
+        while (i >= 0 && Compare<KeyType>::less(key, parent->keys[i]))
         {
             i--;
         }
         i++;
 
         // If child is full, split it
-        if (node->children[i]->key_count == MAX_KEYS)
+        if (parent->children[i]->key_count == MAX_KEYS)
         {
-            Node *split_child = split_node(node->children[i]);
+            Node *split_child = split_node(parent->children[i]);
 
             // Insert middle key into parent
-            for (int j = node->key_count; j > i; j--)
+            for (int j = parent->key_count; j > i; j--)
             {
-                node->keys[j] = node->keys[j - 1];
-                node->children[j + 1] = node->children[j];
+                parent->keys[j] = parent->keys[j - 1];
+                parent->children[j + 1] = parent->children[j];
             }
 
-            node->keys[i] = split_child->keys[0];
-            node->children[i + 1] = split_child;
-            node->key_count++;
+            parent->keys[i] = split_child->keys[0];
+            parent->children[i + 1] = split_child;
+            parent->key_count++;
 
             // Decide which child to recurse into
             if (Compare<KeyType>::less(split_child->keys[0], key))
@@ -190,7 +233,7 @@ private:
             }
         }
 
-        return insert_non_full(node->children[i], key, value);
+        return insert_non_full(parent->children[i], key, std::move(value));
     }
 
     // Recursive search
@@ -202,7 +245,7 @@ private:
             {
                 if (Compare<KeyType>::equal(node->keys[i], key))
                 {
-                    return node->values[i];
+                    return &leaf(node)->values[i];
                 }
             }
             return nullptr;
@@ -215,7 +258,7 @@ private:
             i++;
         }
 
-        return search_recursive(node->children[i], key);
+        return search_recursive(internal(node)->children[i], key);
     }
 
     // Free all nodes recursively
@@ -228,47 +271,47 @@ private:
         {
             for (int i = 0; i <= node->key_count; ++i)
             {
-                destroy_tree(node->children[i]);
+                destroy_tree(internal(node)->children[i]);
             }
         }
-        delete node;
+        free_node(node);
     }
 
     struct PathEntry {
-        Node* parent;
+        InternalNode* parent;
         int index;
         PathEntry* next;
-        PathEntry(Node* p, int i, PathEntry* n) : parent(p), index(i), next(n) {}
+        PathEntry(InternalNode* p, int i, PathEntry* n) : parent(p), index(i), next(n) {}
     };
 
-    void borrow_from_left_leaf(Node* node, Node* left_sibling, Node* parent, int parent_key_index) {
+    void borrow_from_left_leaf(LeafNode* node, LeafNode* left_sibling, InternalNode* parent, int parent_key_index) {
         // Move the last element of left_sibling to the front of node
         node->key_count++;
         for (int i = node->key_count - 1; i > 0; --i) {
             node->keys[i] = node->keys[i - 1];
-            node->values[i] = node->values[i - 1];
+            node->values[i] = std::move(node->values[i - 1]);
         }
         node->keys[0] = left_sibling->keys[left_sibling->key_count - 1];
-        node->values[0] = left_sibling->values[left_sibling->key_count - 1];
+        node->values[0] = std::move(left_sibling->values[left_sibling->key_count - 1]);
         left_sibling->key_count--;
         parent->keys[parent_key_index] = node->keys[0];
     }
 
-    void borrow_from_right_leaf(Node* node, Node* right_sibling, Node* parent, int parent_key_index) {
+    void borrow_from_right_leaf(LeafNode* node, LeafNode* right_sibling, InternalNode* parent, int parent_key_index) {
         // Move the first element of right_sibling to the end of node
         node->keys[node->key_count] = right_sibling->keys[0];
-        node->values[node->key_count] = right_sibling->values[0];
+        node->values[node->key_count] = std::move(right_sibling->values[0]);
         node->key_count++;
         // Shift remaining elements in right_sibling
         for (int i = 0; i < right_sibling->key_count - 1; ++i) {
             right_sibling->keys[i] = right_sibling->keys[i + 1];
-            right_sibling->values[i] = right_sibling->values[i + 1];
+            right_sibling->values[i] = std::move(right_sibling->values[i + 1]);
         }
         right_sibling->key_count--;
         parent->keys[parent_key_index] = right_sibling->keys[0];
     }
 
-    void borrow_from_left_internal(Node* node, Node* left_sibling, Node* parent, int parent_key_index) {
+    void borrow_from_left_internal(InternalNode* node, InternalNode* left_sibling, InternalNode* parent, int parent_key_index) {
         // Take the last key from left_sibling and parent's key
         node->key_count++;
         for (int i = node->key_count - 1; i > 0; --i) {
@@ -284,7 +327,7 @@ private:
         left_sibling->key_count--;
     }
 
-    void borrow_from_right_internal(Node* node, Node* right_sibling, Node* parent, int parent_key_index) {
+    void borrow_from_right_internal(InternalNode* node, InternalNode* right_sibling, InternalNode* parent, int parent_key_index) {
         // Take the first key from right_sibling and parent's key
         node->keys[node->key_count] = parent->keys[parent_key_index];
         node->children[node->key_count + 1] = right_sibling->children[0];
@@ -300,11 +343,11 @@ private:
         right_sibling->key_count--;
     }
 
-    void merge_leaves(Node* left, Node* right, Node* parent, int parent_key_index) {
+    void merge_leaves(LeafNode* left, LeafNode* right, InternalNode* parent, int parent_key_index) {
         // Copy all keys and values from right to left
         for (int i = 0; i < right->key_count; ++i) {
             left->keys[left->key_count + i] = right->keys[i];
-            left->values[left->key_count + i] = right->values[i];
+            left->values[left->key_count + i] = std::move(right->values[i]);
         }
         left->key_count += right->key_count;
         left->next_leaf = right->next_leaf;
@@ -312,7 +355,7 @@ private:
         // Parent's key at parent_key_index is now redundant
     }
 
-    void merge_internal_nodes(Node* left, Node* right, Node* parent, int parent_key_index) {
+    void merge_internal_nodes(InternalNode* left, InternalNode* right, InternalNode* parent, int parent_key_index) {
         // Bring down the parent's key
         left->keys[left->key_count] = parent->keys[parent_key_index];
         left->key_count++;
@@ -331,13 +374,13 @@ private:
             if (stack == nullptr) {
                 // Handle root underflow
                 if (node->key_count == 0 && !node->is_leaf) {
-                    root = node->children[0];
-                    delete node;
+                    root = internal(node)->children[0];
+                    delete internal(node);
                 }
                 break;
             }
 
-            Node* parent = stack->parent;
+            InternalNode* parent = stack->parent;
             int index = stack->index;
             PathEntry* old_entry = stack;
             stack = stack->next;
@@ -349,18 +392,18 @@ private:
             // Try to borrow from left sibling
             if (left_sibling && left_sibling->key_count > MIN_KEYS) {
                 if (node->is_leaf) {
-                    borrow_from_left_leaf(node, left_sibling, parent, index - 1);
+                    borrow_from_left_leaf(leaf(node), leaf(left_sibling), parent, index - 1);
                 } else {
-                    borrow_from_left_internal(node, left_sibling, parent, index - 1);
+                    borrow_from_left_internal(internal(node), internal(left_sibling), parent, index - 1);
                 }
                 break;
             }
             // Try to borrow from right sibling
             else if (right_sibling && right_sibling->key_count > MIN_KEYS) {
                 if (node->is_leaf) {
-                    borrow_from_right_leaf(node, right_sibling, parent, index);
+                    borrow_from_right_leaf(leaf(node), leaf(right_sibling), parent, index);
                 } else {
-                    borrow_from_right_internal(node, right_sibling, parent, index);
+                    borrow_from_right_internal(internal(node), internal(right_sibling), parent, index);
                 }
                 break;
             }
@@ -369,9 +412,9 @@ private:
                 Node* merged_node;
                 if (left_sibling) {
                     if (node->is_leaf) {
-                        merge_leaves(left_sibling, node, parent, index - 1);
+                        merge_leaves(leaf(left_sibling), leaf(node), parent, index - 1);
                     } else {
-                        merge_internal_nodes(left_sibling, node, parent, index - 1);
+                        merge_internal_nodes(internal(left_sibling), internal(node), parent, index - 1);
                     }
                     merged_node = left_sibling;
                     // Remove the parent's key at index - 1
@@ -383,9 +426,9 @@ private:
                     }
                 } else {
                     if (node->is_leaf) {
-                        merge_leaves(node, right_sibling, parent, index);
+                        merge_leaves(leaf(node), leaf(right_sibling), parent, index);
                     } else {
-                        merge_internal_nodes(node, right_sibling, parent, index);
+                        merge_internal_nodes(internal(node), internal(right_sibling), parent, index);
                     }
                     merged_node = node;
                     // Remove the parent's key at index
@@ -419,31 +462,57 @@ public:
         destroy_tree(root);
     }
 
-    // Insert a key-value pair
-    void insert(const KeyType &key, const ValueType &value)
+    BPlusTree(const BPlusTree &) = delete;
+    BPlusTree &operator=(const BPlusTree &) = delete;
+
+    // Move constructor, takes other's nodes, so pointers from search() stay
+    // valid. other is left with an empty leaf as its root
+    BPlusTree(BPlusTree &&other) : BPlusTree()
     {
-        ValueType *value_ptr = new ValueType(value);
+        std::swap(root, other.root);
+    }
 
-        // If root is full, create new root
-        if (root->key_count == MAX_KEYS)
+    // Move assignment, this tree's old nodes are freed and other is left empty
+    BPlusTree &operator=(BPlusTree &&other)
+    {
+        if (this != &other)
         {
-            Node *new_root = create_internal_node();
-            Node *old_root = root;
+            BPlusTree moved(std::move(other));
+            std::swap(root, moved.root);
+        }
+        return *this;
+    }
 
-            root = new_root;
-            new_root->children[0] = old_root;
+    // Insert a key-value pair
+    void insert(const KeyType &key, const ValueType &value)
+    {
+        insert_value(key, ValueType(value));
+    }
 
-            // Split the old root
-            Node *split_child = split_node(old_root);
-            new_root->keys[0] = split_child->keys[0];
-            new_root->children[1] = split_child;
-            new_root->key_count = 1;
-        }
+    void insert(const KeyType &key, ValueType &&value)
+    {
+        insert_value(key, std::move(value));
+    }
 
-        insert_non_full(root, key, value_ptr);
+    // Insert a key with a value constructed from args. The returned value,
+    // like every pointer from search(), is valid until the next modification
+    template <typename... Args>
+    ValueType &emplace(const KeyType &key, Args &&...args)
+    {
+        return *insert_value(key, ValueType(std::forward<Args>(args)...));
+    }
+
+    // Value of key, a default constructed one is inserted if the key is missing
+    ValueType &insert_or_get(const KeyType &key)
+    {
+        ValueType *found = search(key);
+        return found ? *found : emplace(key);
     }
 
-    // Search for a value by key
+    // Search for a value by key. Values are stored inline in the leaves and
+    // move whenever a leaf is split, merged or shifted, so the pointer is only
+    // valid until the next insert, emplace, insert_or_get, remove or
+    // bulk_load; copy the value out before modifying the tree
     ValueType *search(const KeyType &key) const
     {
         return search_recursive(root, key);
@@ -453,7 +522,7 @@ public:
     bool remove(const KeyType& key) {
         PathEntry* stack = nullptr;
         Node* current = root;
-        Node* parent = nullptr;
+        InternalNode* parent = nullptr;
         int index_in_parent = -1;
 
         // Traverse to the leaf node
@@ -463,9 +532,9 @@ public:
                 i++;
             }
             stack = new PathEntry(parent, index_in_parent, stack);
-            parent = current;
+            parent = internal(current);
             index_in_parent = i;
-            current = current->children[i];
+            current = parent->children[i];
         }
 
         // Find the key in the leaf node
@@ -487,16 +556,17 @@ public:
         }
 
         // Delete the key from the leaf
-        delete current->values[pos];
-        for (int i = pos; i < current->key_count - 1; ++i) {
-            current->keys[i] = current->keys[i + 1];
-            current->values[i] = current->values[i + 1];
+        LeafNode* leaf_node = leaf(current);
+        for (int i = pos; i < leaf_node->key_count - 1; ++i) {
+            leaf_node->keys[i] = leaf_node->keys[i + 1];
+            leaf_node->values[i] = std::move(leaf_node->values[i + 1]);
         }
-        current->key_count--;
+        leaf_node->values[leaf_node->key_count - 1] = ValueType();
+        leaf_node->key_count--;
 
         if (current == root) {
             if (current->key_count == 0) {
-                delete root;
+                delete leaf_node;
                 root = create_leaf_node();
             }
             // Cleanup stack
@@ -528,12 +598,12 @@ public:
     class RangeIterator
     {
     private:
-        typename BPlusTree<KeyType, ValueType, ORDER>::Node *current_leaf;
+        typename BPlusTree<KeyType, ValueType, ORDER>::LeafNode *current_leaf;
         int current_index;
         KeyType end_key;
 
     public:
-        RangeIterator(typename BPlusTree<KeyType, ValueType, ORDER>::Node *leaf,
+        RangeIterator(typename BPlusTree<KeyType, ValueType, ORDER>::LeafNode *leaf,
                       int index, const KeyType &end)
             : current_leaf(leaf), current_index(index), end_key(end) {}
 
@@ -551,7 +621,7 @@ public:
             if (!has_next())
                 return nullptr;
 
-            ValueType *result = current_leaf->values[current_index];
+            ValueType *result = &current_leaf->values[current_index];
             current_index++;
 
             // Move to next leaf if needed
@@ -578,7 +648,7 @@ public:
             {
                 i++;
             }
-            current = current->children[i];
+            current = internal(current)->children[i];
         }
 
         // Find first key >= start
@@ -590,7 +660,7 @@ public:
         }
 
         // Return iterator at first valid point
-        return RangeIterator(current, start_index, end);
+        return RangeIterator(leaf(current), start_index, end);
     }
 
     // Bulk load sorted keys and values
@@ -599,37 +669,37 @@ public:
         // Clear existing tree
         destroy_tree(root);
         root = create_leaf_node();
-        Node *current_leaf = root;
+        LeafNode *current_leaf = leaf(root);
 
         // Fill the leaves
         for (size_t i = 0; i < count; ++i)
         {
             if (current_leaf->key_count == MAX_KEYS)
             {
-                Node *new_leaf = create_leaf_node();
+                LeafNode *new_leaf = leaf(create_leaf_node());
                 current_leaf->next_leaf = new_leaf;
                 current_leaf = new_leaf;
             }
             current_leaf->keys[current_leaf->key_count] = keys[i];
-            current_leaf->values[current_leaf->key_count] = new ValueType(values[i]);
+            current_leaf->values[current_leaf->key_count] = values[i];
             current_leaf->key_count++;
         }
 
         // Collect all leaves into an array
         size_t num_leaves = 0;
-        Node *leaf = root;
-        while (leaf != nullptr)
+        LeafNode *leaf_node = leaf(root);
+        while (leaf_node != nullptr)
         {
             num_leaves++;
-            leaf = leaf->next_leaf;
+            leaf_node = leaf_node->next_leaf;
         }
 
         Node **leaves = new Node *[num_leaves];
-        leaf = root;
+        leaf_node = leaf(root);
         for (size_t i = 0; i < num_leaves; ++i)
         {
-            leaves[i] = leaf;
-            leaf = leaf->next_leaf;
+            leaves[i] = leaf_node;
+            leaf_node = leaf_node->next_leaf;
         }
 
         // Build internal levels
@@ -644,7 +714,7 @@ public:
 
             for (size_t i = 0; i < current_level_count;)
             {
-                Node *parent = create_internal_node();
+                InternalNode *parent = internal(create_internal_node());
                 int child_count = 0;
 
                 while (child_count < ORDER && i < current_level_count)
@@ -0,0 +1,118 @@
+#ifndef CONCURRENTHASHMAP_H
+#define CONCURRENTHASHMAP_H
+
+#include "dst/hashmap.h"
+#include <mutex>
+#include <shared_mutex>
+
+// Thread-safe hash map made of lock-striped HashMap shards.
+// A key's shard is chosen by the high bits of its hash (each shard indexes
+// its buckets with the low bits), and every shard has its own reader-writer
+// lock: readers of any shard proceed together, and a writer only blocks
+// access to the one shard it touches. Values are copied out under the lock,
+// since a pointer into a shard could be invalidated by another thread.
+template <typename K, typename V, typename Hash = MixedHash>
+class ConcurrentHashMap
+{
+private:
+    // Own cache line per shard, so locking one does not slow its neighbours
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex lock;
+        HashMap<K, V, Hash> map;
+    };
+
+    Shard *shards;
+    int shardBits;
+
+    Shard &shard(const K &key) const
+    {
+        return shards[shardBits ? Hash::hash(key) >> (32 - shardBits) : 0];
+    }
+
+public:
+    // Constructor, the shard count is rounded up to a power of two
+    ConcurrentHashMap(int shardCount = 16)
+    {
+        shardBits = 0;
+        while ((1 << shardBits) < shardCount)
+        {
+            ++shardBits;
+        }
+        shards = new Shard[1 << shardBits];
+    }
+
+    // Destructor
+    ~ConcurrentHashMap()
+    {
+        delete[] shards;
+    }
+
+    ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+    ConcurrentHashMap &operator=(const ConcurrentHashMap &) = delete;
+
+    // Insert or update a key-value pair
+    void insert(const K &key, const V &value)
+    {
+        Shard &target = shard(key);
+        std::unique_lock<std::shared_mutex> guard(target.lock);
+        target.map.insert(key, value);
+    }
+
+    // Copy the value of key into value, false if the key is missing
+    bool get(const K &key, V &value) const
+    {
+        Shard &target = shard(key);
+        std::shared_lock<std::shared_mutex> guard(target.lock);
+        V *found = target.map.get(key);
+        if (found == nullptr)
+        {
+            return false;
+        }
+        value = *found;
+        return true;
+    }
+
+    // Check whether key is present
+    bool contains(const K &key) const
+    {
+        Shard &target = shard(key);
+        std::shared_lock<std::shared_mutex> guard(target.lock);
+        return target.map.get(key) != nullptr;
+    }
+
+    // Remove a key-value pair
+    bool remove(const K &key)
+    {
+        Shard &target = shard(key);
+        std::unique_lock<std::shared_mutex> guard(target.lock);
+        return target.map.remove(key);
+    }
+
+    // Current size. Shards are counted one at a time, so concurrent writers
+    // may make this a mix of before and after their changes
+    int getSize() const
+    {
+        int size = 0;
+        for (int i = 0; i < (1 << shardBits); ++i)
+        {
+            std::shared_lock<std::shared_mutex> guard(shards[i].lock);
+            size += shards[i].map.getSize();
+        }
+        return size;
+    }
+
+    // Check if hash map is empty
+    bool isEmpty() const
+    {
+        return getSize() == 0;
+    }
+
+    // Number of shards
+    int shardCount() const
+    {
+        return 1 << shardBits;
+    }
+};
+
+#endif // CONCURRENTHASHMAP_H
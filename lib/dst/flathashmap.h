@@ -0,0 +1,419 @@
+#ifndef FLATHASHMAP_H
+#define FLATHASHMAP_H
+
+#include "dst/hash.h"
+#include <utility>
+
+// Open-addressing hash map with Robin Hood probing.
+// Keys and values are stored inline in one flat slot array, with a parallel
+// byte array of probe distances, so a lookup touches one or two cache lines
+// instead of chasing list nodes. Entries with a longer probe distance take
+// over slots from closer ones, which keeps probe sequences short and lets a
+// lookup stop as soon as it passes the key's maximum possible distance.
+//
+// Same interface as HashMap, except that pointers returned by get() are only
+// valid until the next insert or remove: both may move entries.
+template <typename K, typename V, typename Hash = MixedHash>
+class FlatHashMap
+{
+private:
+    struct Slot
+    {
+        K key;
+        V value;
+    };
+
+    // Grow once size passes half the capacity. Probe lengths grow quickly
+    // past that, and every extra probe is a likely branch miss on lookup
+    static const int LOAD_NUM = 1;
+    static const int LOAD_DEN = 2;
+
+    // Probe distances are stored + 1 in a byte, 0 marks an empty slot
+    static const int MAX_DISTANCE = 255;
+
+    Slot *slots;
+    unsigned char *distances;
+    int capacity;
+    int size;
+
+    // Hash function, capacity is a power of two so the mask replaces a modulo
+    unsigned int hash(const K &key) const
+    {
+        return Hash::hash(key) & (capacity - 1);
+    }
+
+    // Next slot, wrapping at the end of the table
+    int next(int index) const
+    {
+        return (index + 1) & (capacity - 1);
+    }
+
+    // Slot holding key, or -1
+    template <typename Q>
+    int find(const Q &key) const
+    {
+        return find(key, Hash::hash(key) & (capacity - 1));
+    }
+
+    template <typename Q>
+    int find(const Q &key, int index) const
+    {
+        // Keys are unique, so any slot holding key that is still within reach
+        // is the one; an entry closer to its home than we are ends the search
+        for (int distance = 1; distances[index] >= distance; ++distance)
+        {
+            if (slots[index].key == key)
+            {
+                return index;
+            }
+            index = next(index);
+        }
+        return -1;
+    }
+
+    // Place a key that is known not to be in the table. Returns its slot, or
+    // -1 if the table had to grow after the key was placed
+    int place(K key, V value)
+    {
+        int index = hash(key);
+        int distance = 1;
+        int placed = -1;
+
+        while (distances[index] != 0)
+        {
+            // Robin Hood: take the slot from an entry closer to its home
+            if (distances[index] < distance)
+            {
+                if (placed < 0)
+                {
+                    placed = index;
+                }
+                std::swap(key, slots[index].key);
+                std::swap(value, slots[index].value);
+                int displaced = distances[index];
+                distances[index] = static_cast<unsigned char>(distance);
+                distance = displaced;
+            }
+
+            index = next(index);
+            if (++distance == MAX_DISTANCE)
+            {
+                // Pathological clustering, spread the table out and retry
+                resize();
+                int moved = place(std::move(key), std::move(value));
+                return placed < 0 ? moved : -1;
+            }
+        }
+
+        slots[index].key = std::move(key);
+        slots[index].value = std::move(value);
+        distances[index] = static_cast<unsigned char>(distance);
+        ++size;
+        return placed < 0 ? index : placed;
+    }
+
+    // Helper function to resize the hash map, moving every entry
+    void resize()
+    {
+        int oldCapacity = capacity;
+        Slot *oldSlots = slots;
+        unsigned char *oldDistances = distances;
+
+        capacity *= 2;
+        allocate();
+
+        for (int i = 0; i < oldCapacity; ++i)
+        {
+            if (oldDistances[i] != 0)
+            {
+                place(std::move(oldSlots[i].key), std::move(oldSlots[i].value));
+            }
+        }
+
+        delete[] oldSlots;
+        delete[] oldDistances;
+    }
+
+    void allocate()
+    {
+        slots = new Slot[capacity];
+        distances = new unsigned char[capacity]();
+        size = 0;
+    }
+
+public:
+    // Constructor, sized so expectedSize entries fit without growing
+    FlatHashMap(int expectedSize = 16)
+    {
+        capacity = powerOfTwoAtLeast((static_cast<long>(expectedSize) + 1) * LOAD_DEN / LOAD_NUM);
+        allocate();
+    }
+
+    // Constructor, built from n key-value pairs
+    FlatHashMap(const K *keys, const V *values, size_t n) : slots(nullptr), distances(nullptr)
+    {
+        build_from(keys, values, n);
+    }
+
+    // Destructor
+    ~FlatHashMap()
+    {
+        delete[] slots;
+        delete[] distances;
+    }
+
+    FlatHashMap(const FlatHashMap &) = delete;
+    FlatHashMap &operator=(const FlatHashMap &) = delete;
+
+    // Move constructor, takes other's slot array. other is left empty with
+    // a table of its own
+    FlatHashMap(FlatHashMap &&other) : FlatHashMap(0)
+    {
+        swap(other);
+    }
+
+    // Move assignment, this map's old entries are freed and other is left empty
+    FlatHashMap &operator=(FlatHashMap &&other)
+    {
+        if (this != &other)
+        {
+            FlatHashMap moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    // Exchange contents with other, no entry is copied or moved
+    void swap(FlatHashMap &other)
+    {
+        std::swap(slots, other.slots);
+        std::swap(distances, other.distances);
+        std::swap(capacity, other.capacity);
+        std::swap(size, other.size);
+    }
+
+    // Insert or update a key-value pair
+    void insert(const K &key, const V &value)
+    {
+        emplace(key, value);
+    }
+
+    void insert(const K &key, V &&value)
+    {
+        emplace(key, std::move(value));
+    }
+
+    // Insert or update, the value is constructed from args
+    template <typename... Args>
+    void emplace(const K &key, Args &&...args)
+    {
+        std::pair<V *, bool> result = try_emplace(key, std::forward<Args>(args)...);
+        if (!result.second)
+        {
+            *result.first = V(std::forward<Args>(args)...);
+        }
+    }
+
+    // Insert a value constructed from args unless key is present. Returns the
+    // key's value, and whether it was inserted; args are unused if not
+    template <typename... Args>
+    std::pair<V *, bool> try_emplace(const K &key, Args &&...args)
+    {
+        int index = find(key);
+        if (index >= 0)
+        {
+            return std::pair<V *, bool>(&slots[index].value, false);
+        }
+
+        // Resize if load factor exceeds 1/2
+        if ((size + 1) * LOAD_DEN > capacity * LOAD_NUM)
+        {
+            resize();
+        }
+
+        index = place(key, V(std::forward<Args>(args)...));
+        if (index < 0)
+        {
+            index = find(key);
+        }
+        return std::pair<V *, bool>(&slots[index].value, true);
+    }
+
+    // Value of key, default constructed first if the key is missing
+    V &insert_or_get(const K &key)
+    {
+        return *try_emplace(key).first;
+    }
+
+    // Replace the contents with n key-value pairs, duplicate keys keep the
+    // last value. The table is sized once for n entries, so there is no load
+    // factor check per entry
+    void build_from(const K *keys, const V *values, size_t n)
+    {
+        delete[] slots;
+        delete[] distances;
+        capacity = powerOfTwoAtLeast((static_cast<long>(n) + 1) * LOAD_DEN / LOAD_NUM);
+        allocate();
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            int index = find(keys[i]);
+            if (index >= 0)
+            {
+                slots[index].value = values[i];
+            }
+            else
+            {
+                place(keys[i], values[i]);
+            }
+        }
+    }
+
+    // Retrieve a value by key, of any type hashing and comparing like K
+    template <typename Q>
+    V *get(const Q &key)
+    {
+        int index = find(key);
+        return index < 0 ? nullptr : &slots[index].value;
+    }
+
+    template <typename Q>
+    const V *get(const Q &key) const
+    {
+        int index = find(key);
+        return index < 0 ? nullptr : &slots[index].value;
+    }
+
+    // Check whether key is present
+    template <typename Q>
+    bool contains(const Q &key) const
+    {
+        return find(key) >= 0;
+    }
+
+    // Look up n keys at once, out[i] = get(keys[i]). The home slots of a
+    // group of keys are prefetched before any of them is probed, so their
+    // cache misses overlap
+    void get_batch(const K *keys, size_t n, V **out)
+    {
+        unsigned int homes[HASH_BATCH_GROUP];
+        for (size_t first = 0; first < n; first += HASH_BATCH_GROUP)
+        {
+            int group = n - first < HASH_BATCH_GROUP ? static_cast<int>(n - first) : HASH_BATCH_GROUP;
+            for (int i = 0; i < group; ++i)
+            {
+                homes[i] = hash(keys[first + i]);
+                __builtin_prefetch(&distances[homes[i]]);
+                __builtin_prefetch(&slots[homes[i]]);
+            }
+            for (int i = 0; i < group; ++i)
+            {
+                int index = find(keys[first + i], homes[i]);
+                out[first + i] = index < 0 ? nullptr : &slots[index].value;
+            }
+        }
+    }
+
+    // Remove a key-value pair
+    bool remove(const K &key)
+    {
+        int index = find(key);
+        if (index < 0)
+        {
+            return false;
+        }
+
+        // Backward shift: pull following displaced entries one slot closer to
+        // home, so no tombstones are needed
+        int following = next(index);
+        while (distances[following] > 1)
+        {
+            slots[index] = std::move(slots[following]);
+            distances[index] = distances[following] - 1;
+            index = following;
+            following = next(following);
+        }
+
+        slots[index] = Slot();
+        distances[index] = 0;
+        --size;
+        return true;
+    }
+
+    // Remove every entry, keeping the capacity
+    void clear()
+    {
+        for (int i = 0; i < capacity; ++i)
+        {
+            if (distances[i] != 0)
+            {
+                slots[i] = Slot();
+                distances[i] = 0;
+            }
+        }
+        size = 0;
+    }
+
+    // Call visit(key, value) for every entry, in table order
+    template <typename F>
+    void for_each(F visit) const
+    {
+        for (int i = 0; i < capacity; ++i)
+        {
+            if (distances[i] != 0)
+            {
+                visit(slots[i].key, slots[i].value);
+            }
+        }
+    }
+
+    // Get current size of the hash map
+    int getSize() const
+    {
+        return size;
+    }
+
+    // Bytes held by the map: the slot and distance arrays. Heap memory owned
+    // by the keys or values themselves is not included
+    size_t memory_usage() const
+    {
+        return sizeof(*this) + static_cast<size_t>(capacity) * (sizeof(Slot) + 1);
+    }
+
+    // Check if hash map is empty
+    bool isEmpty() const
+    {
+        return size == 0;
+    }
+
+    // Slot occupancy, histogram counts entries by probe distance
+    HashStats stats() const
+    {
+        HashStats stats = HashStats();
+        stats.capacity = capacity;
+        stats.size = size;
+        stats.used = size;
+
+        long visited = 0;
+        for (int i = 0; i < capacity; ++i)
+        {
+            int distance = distances[i];
+            if (distance == 0)
+            {
+                continue;
+            }
+            if (distance > stats.longest)
+            {
+                stats.longest = distance;
+            }
+            stats.histogram[distance < HashStats::HISTOGRAM_SIZE ? distance : HashStats::HISTOGRAM_SIZE - 1]++;
+            visited += distance;
+        }
+        stats.averageProbe = size ? static_cast<double>(visited) / size : 0;
+        stats.loadFactor = static_cast<double>(size) / capacity;
+        stats.bytes = memory_usage();
+        return stats;
+    }
+};
+
+#endif // FLATHASHMAP_H
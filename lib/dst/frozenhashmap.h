@@ -0,0 +1,509 @@
+#ifndef FROZENHASHMAP_H
+#define FROZENHASHMAP_H
+
+#include "dst/hash.h"
+#include "dst/flathashmap.h"
+
+// Read-mostly hash map built once from arrays with a minimal perfect hash
+// (CHD: hash, displace and compress). Keys are split into small buckets, and
+// each bucket gets a seed that sends all of its keys to distinct free slots,
+// so every key has exactly one slot: a lookup reads one seed and one slot,
+// with no probing. Memory is the key-value slots plus one seed per two keys.
+//
+// Inserts and removes after the build go to a small FlatHashMap overlay
+// (removing a frozen key records a tombstone there). Once the overlay grows
+// past 1/8 of the frozen keys, everything is frozen again, so updates stay
+// amortised O(1) and the read path stays a single probe. Pointers returned
+// by get() are only valid until the next insert or remove.
+template <typename K, typename V, typename Hash = MixedHash>
+class FrozenHashMap
+{
+private:
+    struct Slot
+    {
+        K key;
+        V value;
+    };
+
+    // Overlay entry: a key added after the build, or a removed frozen key
+    struct Delta
+    {
+        V value;
+        bool removed;
+    };
+
+    // Average keys per bucket. Larger buckets save seed memory but need many
+    // more seed attempts to place the last ones in a nearly full table
+    static const int BUCKET_SIZE = 2;
+
+    // Seeds tried per bucket before its keys are left in the overlay
+    static const unsigned MAX_SEEDS = 1u << 20;
+
+    // Seed flag for single-key buckets: the low bits are the slot itself.
+    // Seed 0 marks a bucket with no frozen keys
+    static const unsigned DIRECT = 0x80000000u;
+
+    // Refreeze once the overlay holds this share of the frozen keys
+    static const int REFREEZE_DIVISOR = 8;
+    static const int REFREEZE_MIN = 64;
+
+    Slot *slots;
+    unsigned *seeds;
+    int slotCount;
+    int bucketCount;
+    int frozenSize;  // keys placed in slots
+    int removedSize; // frozen keys removed through the overlay
+    int overflowSize; // overlay entries left by the last build
+    FlatHashMap<K, Delta, Hash> delta;
+
+    // Map a 32-bit hash onto [0, n) with a multiply instead of a modulo
+    static unsigned reduce(unsigned h, unsigned n)
+    {
+        return static_cast<unsigned>((static_cast<uint64_t>(h) * n) >> 32);
+    }
+
+    // The policy hash is assumed to be mixed already (MixedHash): buckets take
+    // its high bits, and a seed only needs one multiply to reshuffle a bucket
+    unsigned bucketOf(unsigned h) const
+    {
+        return reduce(h, bucketCount);
+    }
+
+    unsigned slotOf(unsigned h, unsigned seed) const
+    {
+        return reduce((h ^ (seed * 0x9e3779b9u)) * 0x85ebca6bu, slotCount);
+    }
+
+    // Slot holding key, or -1
+    template <typename Q>
+    int find(const Q &key) const
+    {
+        if (frozenSize == 0)
+        {
+            return -1;
+        }
+
+        // Both candidates are computed so the choice compiles to a select.
+        // A bucket with seed 0 leads to a slot of another bucket, whose key
+        // cannot match
+        unsigned h = Hash::hash(key);
+        unsigned seed = seeds[bucketOf(h)];
+        unsigned hashed = slotOf(h, seed);
+        int slot = static_cast<int>((seed & DIRECT) ? seed & ~DIRECT : hashed);
+        return slots[slot].key == key ? slot : -1;
+    }
+
+    void release()
+    {
+        delete[] slots;
+        delete[] seeds;
+        slots = nullptr;
+        seeds = nullptr;
+        slotCount = bucketCount = frozenSize = removedSize = overflowSize = 0;
+    }
+
+    // Find a seed placing every key of a bucket in a distinct free slot
+    bool placeBucket(const unsigned *hashes, const int *members, int size, bool *taken, unsigned &seed, int *placedSlots)
+    {
+        // Keys with equal full hashes land together under every seed
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = i + 1; j < size; ++j)
+            {
+                if (hashes[members[i]] == hashes[members[j]])
+                {
+                    return false;
+                }
+            }
+        }
+
+        for (seed = 1; seed < MAX_SEEDS; ++seed)
+        {
+            int placed = 0;
+            for (; placed < size; ++placed)
+            {
+                int slot = slotOf(hashes[members[placed]], seed);
+                if (taken[slot])
+                {
+                    break;
+                }
+                taken[slot] = true;
+                placedSlots[placed] = slot;
+            }
+
+            if (placed == size)
+            {
+                return true;
+            }
+
+            // Collision, undo this attempt
+            for (int i = 0; i < placed; ++i)
+            {
+                taken[placedSlots[i]] = false;
+            }
+        }
+        return false;
+    }
+
+    void build(const K *inKeys, const V *inValues, int n)
+    {
+        release();
+        delta.clear();
+
+        unsigned *hashes = new unsigned[n > 0 ? n : 1];
+        for (int i = 0; i < n; ++i)
+        {
+            hashes[i] = Hash::hash(inKeys[i]);
+        }
+
+        // Counting sort of the input into buckets
+        bucketCount = n / BUCKET_SIZE + 1;
+        int *bucketStart = new int[bucketCount + 1]();
+        for (int i = 0; i < n; ++i)
+        {
+            bucketStart[bucketOf(hashes[i]) + 1]++;
+        }
+        for (int b = 0; b < bucketCount; ++b)
+        {
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        int *members = new int[n > 0 ? n : 1];
+        int *fill = new int[bucketCount];
+        for (int b = 0; b < bucketCount; ++b)
+        {
+            fill[b] = bucketStart[b];
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            members[fill[bucketOf(hashes[i])]++] = i;
+        }
+
+        // Drop duplicate keys within each bucket, the last occurrence wins
+        int maxSize = 0;
+        for (int b = 0; b < bucketCount; ++b)
+        {
+            int size = 0;
+            for (int i = bucketStart[b]; i < bucketStart[b + 1]; ++i)
+            {
+                bool duplicate = false;
+                for (int j = i + 1; j < bucketStart[b + 1] && !duplicate; ++j)
+                {
+                    duplicate = inKeys[members[i]] == inKeys[members[j]];
+                }
+                if (!duplicate)
+                {
+                    members[bucketStart[b] + size++] = members[i];
+                }
+            }
+            fill[b] = size;
+            slotCount += size;
+            if (size > maxSize)
+            {
+                maxSize = size;
+            }
+        }
+
+        // Largest buckets first, while the table is still mostly free
+        int *bySize = new int[maxSize + 2]();
+        for (int b = 0; b < bucketCount; ++b)
+        {
+            bySize[fill[b] + 1]++;
+        }
+        for (int s = 0; s <= maxSize; ++s)
+        {
+            bySize[s + 1] += bySize[s];
+        }
+        int *order = new int[bucketCount];
+        for (int b = 0; b < bucketCount; ++b)
+        {
+            order[bucketCount - 1 - bySize[fill[b]]++] = b;
+        }
+
+        slots = new Slot[slotCount > 0 ? slotCount : 1];
+        seeds = new unsigned[bucketCount]();
+        bool *taken = new bool[slotCount > 0 ? slotCount : 1]();
+        int *placed = new int[maxSize > 0 ? maxSize : 1];
+        int nextFree = 0;
+        int anyPlaced = -1;
+
+        for (int k = 0; k < bucketCount; ++k)
+        {
+            int b = order[k];
+            int size = fill[b];
+            const int *bucket = members + bucketStart[b];
+
+            if (size == 1)
+            {
+                // A lone key takes the next free slot directly
+                while (taken[nextFree])
+                {
+                    ++nextFree;
+                }
+                taken[nextFree] = true;
+                seeds[b] = DIRECT | static_cast<unsigned>(nextFree);
+                placed[0] = nextFree;
+            }
+            else if (size == 0 || !placeBucket(hashes, bucket, size, taken, seeds[b], placed))
+            {
+                // Keys whose full hashes collide can never be separated, they
+                // stay in the overlay with seed 0
+                seeds[b] = 0;
+                for (int i = 0; i < size; ++i)
+                {
+                    delta.insert(inKeys[bucket[i]], Delta{inValues[bucket[i]], false});
+                }
+                continue;
+            }
+
+            for (int i = 0; i < size; ++i)
+            {
+                slots[placed[i]].key = inKeys[bucket[i]];
+                slots[placed[i]].value = inValues[bucket[i]];
+            }
+            frozenSize += size;
+            anyPlaced = placed[0];
+        }
+
+        // Slots left over by overflowed buckets get a copy of a placed key:
+        // a lookup only reaches a slot through that key's own bucket, so the
+        // copy can never match
+        for (int slot = 0; slot < slotCount && anyPlaced >= 0; ++slot)
+        {
+            if (!taken[slot])
+            {
+                slots[slot] = slots[anyPlaced];
+            }
+        }
+
+        overflowSize = delta.getSize();
+
+        delete[] hashes;
+        delete[] bucketStart;
+        delete[] members;
+        delete[] fill;
+        delete[] bySize;
+        delete[] order;
+        delete[] taken;
+        delete[] placed;
+    }
+
+    void refreezeIfNeeded()
+    {
+        if (delta.getSize() - overflowSize > frozenSize / REFREEZE_DIVISOR + REFREEZE_MIN)
+        {
+            refreeze();
+        }
+    }
+
+public:
+    // Constructor, empty until freeze()
+    FrozenHashMap()
+        : slots(nullptr), seeds(nullptr),
+          slotCount(0), bucketCount(0), frozenSize(0), removedSize(0), overflowSize(0) {}
+
+    // Constructor, freezing n key-value pairs
+    FrozenHashMap(const K *keys, const V *values, int n) : FrozenHashMap()
+    {
+        build(keys, values, n);
+    }
+
+    // Destructor
+    ~FrozenHashMap()
+    {
+        release();
+    }
+
+    FrozenHashMap(const FrozenHashMap &) = delete;
+    FrozenHashMap &operator=(const FrozenHashMap &) = delete;
+
+    // Replace the contents with n key-value pairs; duplicate keys keep the last value
+    void freeze(const K *keys, const V *values, int n)
+    {
+        build(keys, values, n);
+    }
+
+    // Fold the overlay into a new perfect hash
+    void refreeze()
+    {
+        int n = getSize();
+        K *liveKeys = new K[n > 0 ? n : 1];
+        V *liveValues = new V[n > 0 ? n : 1];
+
+        int i = 0;
+        for_each([&](const K &key, const V &value) {
+            liveKeys[i] = key;
+            liveValues[i++] = value;
+        });
+
+        build(liveKeys, liveValues, i);
+        delete[] liveKeys;
+        delete[] liveValues;
+    }
+
+    // Insert or update a key-value pair
+    void insert(const K &key, const V &value)
+    {
+        // Frozen keys are updated in place, reviving them if removed
+        int slot = find(key);
+        if (slot >= 0)
+        {
+            slots[slot].value = value;
+            if (delta.remove(key))
+            {
+                --removedSize;
+            }
+            return;
+        }
+
+        delta.insert(key, Delta{value, false});
+        refreezeIfNeeded();
+    }
+
+    // Retrieve a value by key, of any type hashing and comparing like K
+    template <typename Q>
+    V *get(const Q &key)
+    {
+        if (!delta.isEmpty())
+        {
+            Delta *entry = delta.get(key);
+            if (entry != nullptr)
+            {
+                return entry->removed ? nullptr : &entry->value;
+            }
+        }
+
+        int slot = find(key);
+        return slot < 0 ? nullptr : &slots[slot].value;
+    }
+
+    // Look up n keys at once, out[i] = get(keys[i]). Keys are hashed and
+    // their seeds and slots prefetched a group at a time, so the cache misses
+    // of independent lookups overlap instead of running one after another
+    void get_batch(const K *keys, size_t n, V **out)
+    {
+        if (frozenSize == 0 || !delta.isEmpty())
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = get(keys[i]);
+            }
+            return;
+        }
+
+        unsigned hashes[HASH_BATCH_GROUP];
+        unsigned found[HASH_BATCH_GROUP];
+        for (size_t first = 0; first < n; first += HASH_BATCH_GROUP)
+        {
+            int group = n - first < HASH_BATCH_GROUP ? static_cast<int>(n - first) : HASH_BATCH_GROUP;
+            const K *groupKeys = keys + first;
+
+            for (int i = 0; i < group; ++i)
+            {
+                hashes[i] = Hash::hash(groupKeys[i]);
+                __builtin_prefetch(&seeds[bucketOf(hashes[i])]);
+            }
+            for (int i = 0; i < group; ++i)
+            {
+                unsigned seed = seeds[bucketOf(hashes[i])];
+                unsigned hashed = slotOf(hashes[i], seed);
+                found[i] = (seed & DIRECT) ? seed & ~DIRECT : hashed;
+                __builtin_prefetch(&slots[found[i]]);
+            }
+            for (int i = 0; i < group; ++i)
+            {
+                Slot &slot = slots[found[i]];
+                out[first + i] = slot.key == groupKeys[i] ? &slot.value : nullptr;
+            }
+        }
+    }
+
+    // Remove a key-value pair
+    bool remove(const K &key)
+    {
+        Delta *entry = delta.get(key);
+        if (entry != nullptr)
+        {
+            if (entry->removed)
+            {
+                return false;
+            }
+            delta.remove(key);
+            return true;
+        }
+
+        if (find(key) < 0)
+        {
+            return false;
+        }
+
+        delta.insert(key, Delta{V(), true});
+        ++removedSize;
+        refreezeIfNeeded();
+        return true;
+    }
+
+    // Get current size of the hash map
+    int getSize() const
+    {
+        return frozenSize - removedSize + delta.getSize() - removedSize;
+    }
+
+    // Check if hash map is empty
+    bool isEmpty() const
+    {
+        return getSize() == 0;
+    }
+
+    // Call visit(key, value) for every entry: frozen slots in order, then
+    // keys added since the last freeze
+    template <typename F>
+    void for_each(F visit) const
+    {
+        for (int slot = 0; slot < slotCount; ++slot)
+        {
+            // Placed slots are exactly those a lookup of their key reaches,
+            // a frozen key in the overlay is a tombstone
+            if (find(slots[slot].key) == slot && (removedSize == 0 || !delta.contains(slots[slot].key)))
+            {
+                visit(slots[slot].key, slots[slot].value);
+            }
+        }
+        delta.for_each([&](const K &key, const Delta &entry) {
+            if (!entry.removed)
+            {
+                visit(key, entry.value);
+            }
+        });
+    }
+
+    // Bytes held by the map: slots, seeds and the overlay. Heap memory owned
+    // by the keys or values themselves is not included
+    size_t memory_usage() const
+    {
+        return sizeof(*this) - sizeof(delta) + static_cast<size_t>(slotCount) * sizeof(Slot) +
+               static_cast<size_t>(bucketCount) * sizeof(unsigned) + delta.memory_usage();
+    }
+
+    // Entries held in the overlay, including tombstones
+    int deltaSize() const
+    {
+        return delta.getSize();
+    }
+
+    // Slot occupancy of the frozen part, every placed key is one probe away
+    HashStats stats() const
+    {
+        HashStats stats = HashStats();
+        stats.capacity = slotCount;
+        stats.size = frozenSize;
+        stats.used = frozenSize;
+        stats.longest = frozenSize ? 1 : 0;
+        stats.averageProbe = frozenSize ? 1 : 0;
+        stats.histogram[1] = frozenSize;
+        stats.loadFactor = slotCount ? static_cast<double>(frozenSize) / slotCount : 0;
+        stats.bytes = memory_usage();
+        return stats;
+    }
+};
+
+#endif // FROZENHASHMAP_H
@@ -0,0 +1,115 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Hash policies for HashMap and FlatHashMap.
+// A policy is any type with a static hash(key) returning unsigned int. Both
+// maps index power-of-two tables with the low bits of the hash, so a policy
+// should spread keys over those bits. Pass a custom policy as the third
+// template argument.
+//
+// Maps look keys up through templates, so a key of another type can be
+// passed to get() as long as the policy hashes it like the stored key type
+// and the two compare with ==: std::string keys can be found with a
+// std::string_view or a const char * without building a temporary string.
+
+// Integers map to themselves, strings hash their characters (FNV-1a).
+// Only suitable when keys are already well spread in their low bits
+struct IdentityHash
+{
+    // Other types use the standard library hash of their value. Anything
+    // that converts to std::string_view (char *, char arrays) is text and
+    // must take the string overloads below, not std::hash of its address
+    template <typename T, typename = std::enable_if_t<!std::is_convertible<const T &, std::string_view>::value>>
+    static unsigned int hash(const T &key)
+    {
+        return static_cast<unsigned int>(std::hash<T>()(key));
+    }
+
+    // Specialized hash functions for primitive types
+    static unsigned int hash(int key) { return static_cast<unsigned int>(key); }
+    static unsigned int hash(unsigned int key) { return key; }
+    static unsigned int hash(long key) { return static_cast<unsigned int>(key); }
+
+    // Every string type hashes its text the same way
+    static unsigned int hash(std::string_view key)
+    {
+        unsigned int hash = 2166136261u;
+        for (char c : key)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        return hash;
+    }
+    static unsigned int hash(const char *key)
+    {
+        return hash(std::string_view(key));
+    }
+    static unsigned int hash(const std::string &key)
+    {
+        return hash(std::string_view(key));
+    }
+};
+
+// MurmurHash3 fmix32 finalizer: every input bit affects every output bit
+inline unsigned int mixHash(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+// Identity followed by the finalizer, so clustered or strided ids still
+// spread evenly over a power-of-two table. The default policy
+struct MixedHash
+{
+    template <typename T>
+    static unsigned int hash(const T &key)
+    {
+        return mixHash(IdentityHash::hash(key));
+    }
+};
+
+// Smallest power of two >= n, at least 1
+inline int powerOfTwoAtLeast(long n)
+{
+    int capacity = 1;
+    while (capacity < n)
+    {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// Keys get_batch() hashes and prefetches before resolving any of them:
+// enough cache misses in flight to overlap their latency
+const int HASH_BATCH_GROUP = 16;
+
+// Occupancy of a hash table, to check how well a policy spreads real keys
+struct HashStats
+{
+    static const int HISTOGRAM_SIZE = 8;
+
+    int capacity;        // buckets or slots
+    int size;            // entries
+    int used;            // non-empty buckets or slots
+    int longest;         // longest chain, or longest probe distance
+    double averageProbe; // chain entries or slots visited by a successful get
+    double loadFactor;   // entries per bucket or slot
+    size_t bytes;        // memory_usage() of the map
+
+    // HashMap: buckets by chain length. FlatHashMap: entries by probe
+    // distance (1 = home slot). The last bin counts that length or more
+    int histogram[HISTOGRAM_SIZE];
+};
+
+#endif // HASH_H
@@ -2,9 +2,20 @@
 #define HASHMAP_H
 
 #include "dst/linkedlist.h"
-#include <cstdint>
+#include "dst/hash.h"
+#include <new>
+#include <utility>
 
-template <typename K, typename V>
+// Chained hash map over a power-of-two bucket array. Hash is a policy from
+// dst/hash.h (or any type with a static hash(key)).
+// Every entry lives in its own list node and resizing relinks nodes rather
+// than copying them, so a pointer returned by get() stays valid until its
+// key is removed. The nodes of all chains come from one NodePool owned by
+// the map.
+// In incremental mode a resize does not rehash everything at once: the old
+// bucket array is kept, and every insert or remove moves a few entries into
+// the new array, so no single insert pays for the whole table
+template <typename K, typename V, typename Hash = MixedHash>
 class HashMap
 {
 private:
@@ -13,146 +24,459 @@ private:
     {
         K key;
         V value;
-        Entry(const K &k, const V &v) : key(k), value(v) {}
+        template <typename... Args>
+        Entry(const K &k, Args &&...args) : key(k), value(std::forward<Args>(args)...) {}
 
         bool operator==(const Entry &other) const {
             return key == other.key;
         }
     };
 
+    typedef LinkedList<Entry, PoolAllocator> Chain;
+
+    // Work done per insert or remove while a resize is in progress: entries
+    // moved and empty old buckets skipped. The old table holds
+    // 0.75 * oldCapacity entries when the resize starts and the doubled
+    // table takes as many inserts again to fill, so the migration is done
+    // before the next resize is due.
+    // New buckets are built PREPARE_CHUNK pairs at a time, half a chunk
+    // ahead of the migration. Building them is what faults in the fresh
+    // pages, and a few large chunks keep those faults out of all but a
+    // handful of inserts
+    static const int PREPARE_CHUNK = 4096;
+    static const int MIGRATE_ENTRIES = 2;
+    static const int MIGRATE_BUCKETS = 4;
+
     // Array of linked lists for collision resolution
-    LinkedList<Entry> *table;
+    Chain *table;
     int capacity;
     int size;
 
-    // Hash function
+    // Nodes of every chain, old and new table alike
+    NodePool *nodes;
+
+    // Buckets of the previous table still to be moved, nullptr when no
+    // incremental resize is in progress. Old bucket i splits into new
+    // buckets i and i + oldCapacity: both exist once i < prepared, old
+    // buckets below migrated are empty, and old bucket migrated may have
+    // handed some of its entries over already
+    Chain *oldTable;
+    int oldCapacity;
+    int prepared;
+    int migrated;
+    bool incremental;
+
+    // Hash function, capacity is a power of two so the mask replaces a modulo
     unsigned int hash(const K &key) const
     {
-        return hashCode(key) % capacity;
+        return Hash::hash(key) & (capacity - 1);
     }
 
-    // Helper function to resize the hash map
-    void resize()
+    template <typename Q>
+    static Entry *search(Chain &chain, const Q &key)
     {
-        int oldCapacity = capacity;
-        capacity *= 2;
-        LinkedList<Entry> *oldTable = table;
+        for (auto &entry : chain)
+        {
+            if (entry.key == key)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
 
-        // Allocate new table
-        table = new LinkedList<Entry>[capacity];
+    // Entry for key, or nullptr. chain is set to the bucket holding it
+    template <typename Q>
+    Entry *find(const Q &key, Chain *&chain) const
+    {
+        unsigned int h = Hash::hash(key);
+        if (oldTable)
+        {
+            int old = h & (oldCapacity - 1);
+            if (old >= migrated)
+            {
+                chain = &oldTable[old];
+                Entry *entry = search(*chain, key);
+                if (entry || old > migrated || old >= prepared)
+                {
+                    return entry;
+                }
+            }
+        }
+        chain = &table[h & (capacity - 1)];
+        return search(*chain, key);
+    }
 
-        // Rehash existing entries
-        size = 0;
-        for (int i = 0; i < oldCapacity; ++i)
+    // Bucket a new entry for key goes into: the old one until its split
+    // has started
+    template <typename Q>
+    Chain &bucket(const Q &key) const
+    {
+        unsigned int h = Hash::hash(key);
+        int old = h & (oldCapacity - 1);
+        if (oldTable && (old > migrated || old >= prepared))
         {
-            for (auto &entry : oldTable[i])
+            return oldTable[old];
+        }
+        return table[h & (capacity - 1)];
+    }
+
+    // Bucket storage is raw memory, buckets are constructed in place
+    static Chain *allocateBuckets(int count)
+    {
+        return static_cast<Chain *>(::operator new(sizeof(Chain) * count));
+    }
+
+    // Construct up to count more pairs of new buckets
+    void prepare(int count)
+    {
+        for (; count > 0 && prepared < oldCapacity; --count, ++prepared)
+        {
+            new (&table[prepared]) Chain(PoolAllocator(nodes));
+            new (&table[prepared + oldCapacity]) Chain(PoolAllocator(nodes));
+        }
+    }
+
+    // Move up to entries entries into the new table, passing over at most
+    // buckets empty old buckets, and only into buckets already prepared
+    void migrate(int entries, int buckets)
+    {
+        while (migrated < prepared)
+        {
+            Chain &old = oldTable[migrated];
+            if (old.empty())
             {
-                insert(entry.key, entry.value);
+                ++migrated;
+                if (--buckets == 0)
+                {
+                    break;
+                }
             }
+            else
+            {
+                if (entries-- == 0)
+                {
+                    break;
+                }
+                old.move_front_to(table[hash(old.front().key)]);
+            }
+        }
+
+        // Every old bucket is empty now, only the storage is left
+        if (migrated == oldCapacity)
+        {
+            ::operator delete(oldTable);
+            oldTable = nullptr;
+        }
+    }
+
+    // One bounded step of an incremental resize
+    void step()
+    {
+        if (prepared - migrated < PREPARE_CHUNK / 2)
+        {
+            prepare(PREPARE_CHUNK);
         }
+        migrate(MIGRATE_ENTRIES, MIGRATE_BUCKETS);
+    }
+
+    // Build and move everything still pending
+    void finishResize()
+    {
+        prepare(oldCapacity);
+        migrate(size, oldCapacity);
+    }
 
-        delete[] oldTable;
+    // Whether bucket i of the current table has been constructed
+    bool built(int i) const
+    {
+        return !oldTable || (i & (oldCapacity - 1)) < prepared;
     }
 
-    // Fallback hash function for generic types
-    template <typename T>
-    unsigned int hashCode(const T &key) const
+    // Allocate an empty table with every bucket constructed
+    void create(int newCapacity)
     {
-        return static_cast<unsigned int>(reinterpret_cast<uintptr_t>(&key));
+        capacity = newCapacity;
+        size = 0;
+        table = allocateBuckets(capacity);
+        for (int i = 0; i < capacity; ++i)
+        {
+            new (&table[i]) Chain(PoolAllocator(nodes));
+        }
     }
 
-    // Specialized hash functions for primitive types
-    unsigned int hashCode(int key) const { return static_cast<unsigned int>(key); }
-    unsigned int hashCode(unsigned int key) const { return key; }
-    unsigned int hashCode(long key) const { return static_cast<unsigned int>(key); }
-    unsigned int hashCode(const char *key) const
+    // Free every entry and both tables
+    void release()
     {
-        unsigned int hash = 0;
-        while (*key)
+        for (int i = 0; i < capacity; ++i)
+        {
+            if (built(i))
+            {
+                table[i].~LinkedList();
+            }
+        }
+        ::operator delete(table);
+
+        if (oldTable)
         {
-            hash = hash * 31 + *key;
-            ++key;
+            for (int i = migrated; i < oldCapacity; ++i)
+            {
+                oldTable[i].~LinkedList();
+            }
+            ::operator delete(oldTable);
+            oldTable = nullptr;
         }
-        return hash;
     }
-    unsigned int hashCode(const std::string &key) const
+
+    // Helper function to resize the hash map
+    void resize()
     {
-        return hashCode(key.c_str());
+        // Finish a resize still in progress first
+        if (oldTable)
+        {
+            finishResize();
+        }
+
+        oldCapacity = capacity;
+        capacity *= 2;
+        oldTable = table;
+        prepared = 0;
+        migrated = 0;
+
+        // Allocate new table
+        table = allocateBuckets(capacity);
+
+        // Nodes are relinked to their new bucket, entries are neither copied
+        // nor reallocated. Incremental mode leaves this to later operations
+        if (!incremental)
+        {
+            finishResize();
+        }
     }
 
 public:
-    // Constructor
-    HashMap(int initialCapacity = 16) : capacity(initialCapacity), size(0)
+    // Constructor, the capacity is rounded up to a power of two
+    HashMap(int initialCapacity = 16, bool incremental = false)
+        : nodes(new NodePool(Chain::nodeBytes())),
+          oldTable(nullptr), oldCapacity(0), prepared(0), migrated(0), incremental(incremental)
+    {
+        create(powerOfTwoAtLeast(initialCapacity));
+    }
+
+    // Constructor, built from n key-value pairs
+    HashMap(const K *keys, const V *values, size_t n, bool incremental = false)
+        : table(nullptr), capacity(0), size(0), nodes(new NodePool(Chain::nodeBytes())),
+          oldTable(nullptr), oldCapacity(0), prepared(0), migrated(0), incremental(incremental)
     {
-        table = new LinkedList<Entry>[capacity];
+        build_from(keys, values, n);
     }
 
     // Destructor
     ~HashMap()
     {
-        delete[] table;
+        release();
+        delete nodes;
+    }
+
+    HashMap(const HashMap &) = delete;
+    HashMap &operator=(const HashMap &) = delete;
+
+    // Move constructor, takes other's tables and node pool, so pointers to
+    // its values stay valid. other is left empty with a table of its own
+    HashMap(HashMap &&other) : HashMap(1, other.incremental)
+    {
+        swap(other);
+    }
+
+    // Move assignment, this map's old entries are freed and other is left empty
+    HashMap &operator=(HashMap &&other)
+    {
+        if (this != &other)
+        {
+            HashMap moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    // Exchange contents with other, no entry is copied or moved
+    void swap(HashMap &other)
+    {
+        std::swap(table, other.table);
+        std::swap(capacity, other.capacity);
+        std::swap(size, other.size);
+        std::swap(nodes, other.nodes);
+        std::swap(oldTable, other.oldTable);
+        std::swap(oldCapacity, other.oldCapacity);
+        std::swap(prepared, other.prepared);
+        std::swap(migrated, other.migrated);
+        std::swap(incremental, other.incremental);
     }
 
     // Insert or update a key-value pair
     void insert(const K &key, const V &value)
     {
+        emplace(key, value);
+    }
+
+    void insert(const K &key, V &&value)
+    {
+        emplace(key, std::move(value));
+    }
+
+    // Insert or update, the value is constructed from args. A new entry is
+    // built in its list node, never copied
+    template <typename... Args>
+    void emplace(const K &key, Args &&...args)
+    {
+        std::pair<V *, bool> result = try_emplace(key, std::forward<Args>(args)...);
+        if (!result.second)
+        {
+            *result.first = V(std::forward<Args>(args)...);
+        }
+    }
+
+    // Insert a value constructed from args unless key is present. Returns the
+    // key's value, and whether it was inserted; args are unused if not
+    template <typename... Args>
+    std::pair<V *, bool> try_emplace(const K &key, Args &&...args)
+    {
+        if (oldTable)
+        {
+            step();
+        }
+
         // Resize if load factor exceeds 0.75
         if (static_cast<double>(size) / capacity >= 0.75)
         {
             resize();
         }
 
-        unsigned int index = hash(key);
-
-        // Check if key already exists in the list
-        for (auto &entry : table[index])
+        // Check if key already exists
+        Chain *chain;
+        Entry *entry = find(key, chain);
+        if (entry)
         {
-            if (entry.key == key)
-            {
-                entry.value = value;
-                return;
-            }
+            return std::pair<V *, bool>(&entry->value, false);
         }
 
         // If key doesn't exist, add new entry
-        table[index].push_back(Entry(key, value));
+        Entry &created = bucket(key).emplace_back(key, std::forward<Args>(args)...);
         ++size;
+        return std::pair<V *, bool>(&created.value, true);
+    }
+
+    // Value of key, default constructed first if the key is missing
+    V &insert_or_get(const K &key)
+    {
+        return *try_emplace(key).first;
     }
 
-    // Retrieve a value by key
-    V *get(const K &key)
+    // Replace the contents with n key-value pairs, duplicate keys keep the
+    // last value. The table is sized once for n entries, so there is no load
+    // factor check or resize per entry
+    void build_from(const K *keys, const V *values, size_t n)
     {
-        unsigned int index = hash(key);
+        release();
+        create(powerOfTwoAtLeast(static_cast<long>(n) * 4 / 3 + 1));
 
-        // Search through the linked list at this index
-        for (auto &entry : table[index])
+        for (size_t i = 0; i < n; ++i)
         {
-            if (entry.key == key)
+            Chain &chain = table[hash(keys[i])];
+            Entry *entry = search(chain, keys[i]);
+            if (entry)
+            {
+                entry->value = values[i];
+            }
+            else
             {
-                return &entry.value;
+                chain.emplace_back(keys[i], values[i]);
+                ++size;
             }
         }
+    }
 
-        return nullptr;
+    // Call visit(key, value) for every entry, bucket by bucket
+    template <typename F>
+    void for_each(F visit) const
+    {
+        for (int i = 0; i < capacity; ++i)
+        {
+            if (built(i))
+            {
+                for (auto &entry : table[i])
+                {
+                    visit(entry.key, entry.value);
+                }
+            }
+        }
+        for (int i = oldTable ? migrated : 0; oldTable && i < oldCapacity; ++i)
+        {
+            for (auto &entry : oldTable[i])
+            {
+                visit(entry.key, entry.value);
+            }
+        }
     }
-    // Remove a key-value pair
-    bool remove(const K &key)
+
+    // Bytes held by the map: bucket arrays and the node pool, free nodes
+    // included. Heap memory owned by the keys or values themselves is not
+    size_t memory_usage() const
+    {
+        size_t buckets = capacity + (oldTable ? oldCapacity : 0);
+        return sizeof(*this) + sizeof(NodePool) + buckets * sizeof(Chain) + nodes->reservedBytes();
+    }
+
+    // Retrieve a value by key, the pointer survives later inserts and resizes.
+    // key may be of any type hashing and comparing like K
+    template <typename Q>
+    V *get(const Q &key)
+    {
+        Chain *chain;
+        Entry *entry = find(key, chain);
+        return entry ? &entry->value : nullptr;
+    }
+    // Look up n keys at once, out[i] = get(keys[i]). The buckets of a group
+    // of keys are prefetched before any chain is walked, so their cache
+    // misses overlap. During a resize the prefetched bucket is where the
+    // key would be inserted, the lookup still checks both tables
+    void get_batch(const K *keys, size_t n, V **out)
     {
-        unsigned int index = hash(key);
-    
-        // Search through the linked list at this index
-        for (auto &entry : table[index])
+        for (size_t first = 0; first < n; first += HASH_BATCH_GROUP)
         {
-            if (entry.key == key)
+            int group = n - first < HASH_BATCH_GROUP ? static_cast<int>(n - first) : HASH_BATCH_GROUP;
+            for (int i = 0; i < group; ++i)
+            {
+                __builtin_prefetch(&bucket(keys[first + i]));
+            }
+            for (int i = 0; i < group; ++i)
             {
-                // Use the LinkedList's remove method directly with the entry
-                table[index].remove(entry);
-                --size;
-                return true;
+                Chain *chain;
+                Entry *entry = find(keys[first + i], chain);
+                out[first + i] = entry ? &entry->value : nullptr;
             }
         }
-    
-        return false;
+    }
+
+    // Remove a key-value pair
+    bool remove(const K &key)
+    {
+        if (oldTable)
+        {
+            step();
+        }
+
+        Chain *chain;
+        Entry *entry = find(key, chain);
+        if (!entry)
+        {
+            return false;
+        }
+
+        // Use the LinkedList's remove method directly with the entry
+        chain->remove(*entry);
+        --size;
+        return true;
     }
 
     // Get current size of the hash map
@@ -166,6 +490,42 @@ public:
     {
         return size == 0;
     }
+
+    // Bucket occupancy, histogram counts buckets by chain length
+    HashStats stats() const
+    {
+        HashStats stats = HashStats();
+        stats.capacity = capacity;
+        stats.size = size;
+
+        // Buckets not yet migrated count as chains of their own
+        long visited = 0;
+        int pending = oldTable ? oldCapacity - migrated : 0;
+        for (int i = 0; i < capacity + pending; ++i)
+        {
+            if (i < capacity && !built(i))
+            {
+                continue;
+            }
+            int length = i < capacity ? table[i].getSize() : oldTable[migrated + i - capacity].getSize();
+            if (length > 0)
+            {
+                ++stats.used;
+            }
+            if (length > stats.longest)
+            {
+                stats.longest = length;
+            }
+            stats.histogram[length < HashStats::HISTOGRAM_SIZE ? length : HashStats::HISTOGRAM_SIZE - 1]++;
+
+            // Finding the k-th entry of a chain visits k entries
+            visited += static_cast<long>(length) * (length + 1) / 2;
+        }
+        stats.averageProbe = size ? static_cast<double>(visited) / size : 0;
+        stats.loadFactor = static_cast<double>(size) / capacity;
+        stats.bytes = memory_usage();
+        return stats;
+    }
 };
 
-#endif // HASHMAP_H
\ No newline at end of file
+#endif // HASHMAP_H
@@ -1,9 +1,17 @@
 #ifndef LINKED_LIST_H
 #define LINKED_LIST_H
 
+#include <cstddef>
+#include <new>
 #include <stdexcept>
+#include <utility>
 
-template <typename T>
+#include "dst/nodepool.h"
+
+// Singly linked list. Nodes come from the list's own Alloc object (see
+// dst/nodepool.h): by default a NodePool private to the list, or a NodePool
+// shared with the other lists of the same owner
+template <typename T, typename Alloc = OwnPoolAllocator>
 class LinkedList
 {
 private:
@@ -13,17 +21,45 @@ private:
         T data;
         Node *next;
 
-        // Constructor to initialize node
-        Node(const T &value) : data(value), next(nullptr) {}
+        // Constructor, data is built from args in place
+        template <typename... Args>
+        Node(Args &&...args) : data(std::forward<Args>(args)...), next(nullptr) {}
     };
 
     Node *head;
     Node *tail;
     int size;
+    Alloc alloc;
+
+    template <typename... Args>
+    Node *createNode(Args &&...args)
+    {
+        return new (alloc.template allocate<Node>()) Node(std::forward<Args>(args)...);
+    }
+
+    void append(Node *node)
+    {
+        if (!head)
+        {
+            head = tail = node;
+        }
+        else
+        {
+            tail->next = node;
+            tail = node;
+        }
+        ++size;
+    }
+
+    void destroyNode(Node *node)
+    {
+        node->~Node();
+        alloc.template release<Node>(node);
+    }
 
 public:
     // Constructor
-    LinkedList() : head(nullptr), tail(nullptr), size(0) {}
+    LinkedList(const Alloc &allocator = Alloc()) : head(nullptr), tail(nullptr), size(0), alloc(allocator) {}
 
     // Destructor to free memory
     ~LinkedList()
@@ -31,8 +67,8 @@ public:
         clear();
     }
 
-    // Copy constructor
-    LinkedList(const LinkedList &other) : head(nullptr), tail(nullptr), size(0)
+    // Copy constructor, the copy gets a copy of other's allocator
+    LinkedList(const LinkedList &other) : head(nullptr), tail(nullptr), size(0), alloc(other.alloc)
     {
         Node *current = other.head;
         while (current)
@@ -42,7 +78,7 @@ public:
         }
     }
 
-    // Copy assignment operator
+    // Copy assignment operator, new nodes come from this list's allocator
     LinkedList &operator=(const LinkedList &other)
     {
         if (this != &other)
@@ -61,28 +97,54 @@ public:
         return *this;
     }
 
-    // Add element to the end of the list
-    void push_back(const T &value)
+    // Move constructor, takes other's nodes and allocator and leaves it empty
+    LinkedList(LinkedList &&other)
+        : head(other.head), tail(other.tail), size(other.size), alloc(std::move(other.alloc))
     {
-        Node *newNode = new Node(value);
+        other.head = other.tail = nullptr;
+        other.size = 0;
+    }
 
-        if (!head)
-        {
-            head = tail = newNode;
-        }
-        else
+    // Move assignment operator, the allocator moves along with the nodes
+    LinkedList &operator=(LinkedList &&other)
+    {
+        if (this != &other)
         {
-            tail->next = newNode;
-            tail = newNode;
+            clear();
+            head = other.head;
+            tail = other.tail;
+            size = other.size;
+            alloc = std::move(other.alloc);
+            other.head = other.tail = nullptr;
+            other.size = 0;
         }
+        return *this;
+    }
 
-        ++size;
+    // Add element to the end of the list
+    void push_back(const T &value)
+    {
+        append(createNode(value));
+    }
+
+    void push_back(T &&value)
+    {
+        append(createNode(std::move(value)));
+    }
+
+    // Construct an element at the end of the list from args, returns it
+    template <typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+        Node *newNode = createNode(std::forward<Args>(args)...);
+        append(newNode);
+        return newNode->data;
     }
 
     // Add element to the beginning of the list
     void push_front(const T &value)
     {
-        Node *newNode = new Node(value);
+        Node *newNode = createNode(value);
 
         if (!head)
         {
@@ -105,7 +167,7 @@ public:
 
         Node *temp = head;
         head = head->next;
-        delete temp;
+        destroyNode(temp);
 
         --size;
 
@@ -116,7 +178,36 @@ public:
         }
     }
 
-    bool contain(T &target){
+    // Move the first node to the end of another list drawing from the same
+    // pool, so not between lists with the default allocator. The node is
+    // relinked, not copied, so pointers to its data stay valid
+    void move_front_to(LinkedList &other)
+    {
+        if (!head)
+            return;
+
+        Node *node = head;
+        head = head->next;
+        if (!head)
+        {
+            tail = nullptr;
+        }
+        --size;
+
+        node->next = nullptr;
+        if (!other.head)
+        {
+            other.head = other.tail = node;
+        }
+        else
+        {
+            other.tail->next = node;
+            other.tail = node;
+        }
+        ++other.size;
+    }
+
+    bool contain(const T &target) const {
         Node* current = head;
         while(current){
             if(current->data == target){
@@ -127,7 +218,7 @@ public:
         return false;
     }
 
-    bool remove(T target){
+    bool remove(const T &target){
         if (!head) {
             return false;
         }
@@ -135,7 +226,7 @@ public:
         if (head->data == target) {
             Node* temp = head;
             head = head->next;
-            delete temp;
+            destroyNode(temp);
             if (!head) {
                 tail = nullptr;
             }
@@ -151,7 +242,7 @@ public:
                 if (toDelete == tail) {
                     tail = current;
                 }
-                delete toDelete;
+                destroyNode(toDelete);
                 --size;
                 return true;
             }
@@ -188,7 +279,7 @@ public:
         {
             Node *temp = head;
             head = head->next;
-            delete temp;
+            destroyNode(temp);
         }
         head = tail = nullptr;
         size = 0;
@@ -206,6 +297,12 @@ public:
         return size;
     }
 
+    // Heap bytes taken by each element
+    static constexpr size_t nodeBytes()
+    {
+        return sizeof(Node);
+    }
+
     // Iterator support for range-based for loops
     class Iterator
     {
@@ -0,0 +1,261 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Pool of fixed-size nodes.
+// Nodes are carved out of large blocks, so consecutive allocations sit next
+// to each other in memory, and a freed node goes on a free list to be handed
+// out again before the pool grows. Blocks are only returned to the system
+// all at once, when the pool is destroyed.
+// A pool belongs to one owner (a list, or a HashMap for all its chains) and
+// is not thread safe: whatever guards the owner guards its pool too, so
+// ConcurrentHashMap shards never contend on a shared allocator.
+class NodePool
+{
+private:
+    // Blocks start small, so a pool per list costs little for short lists,
+    // and double up to about BLOCK_BYTES
+    static const size_t BLOCK_BYTES = 64 * 1024;
+    static const size_t FIRST_BLOCK_NODES = 4;
+
+    // Header of each block, the nodes follow it
+    struct alignas(std::max_align_t) Block
+    {
+        Block *next;
+        size_t nodes;
+    };
+
+    // A free node stores the next free node in its own bytes
+    struct FreeNode
+    {
+        FreeNode *next;
+    };
+
+    size_t nodeBytes;
+    size_t nodesPerBlock; // size of the next block
+    size_t maxNodesPerBlock;
+    Block *blocks;
+    FreeNode *freeList;
+    char *unused;    // next never-used node of the newest block
+    char *unusedEnd; // end of the newest block
+    size_t live;     // nodes handed out and not released
+
+    void releaseBlocks()
+    {
+        while (blocks)
+        {
+            Block *next = blocks->next;
+            ::operator delete(blocks);
+            blocks = next;
+        }
+    }
+
+    void takeFrom(NodePool &other)
+    {
+        nodeBytes = other.nodeBytes;
+        nodesPerBlock = other.nodesPerBlock;
+        maxNodesPerBlock = other.maxNodesPerBlock;
+        blocks = other.blocks;
+        freeList = other.freeList;
+        unused = other.unused;
+        unusedEnd = other.unusedEnd;
+        live = other.live;
+        other.blocks = nullptr;
+        other.freeList = nullptr;
+        other.unused = other.unusedEnd = nullptr;
+        other.live = 0;
+    }
+
+public:
+    // Constructor, bytes is the node size
+    NodePool(size_t bytes)
+        : nodeBytes(bytes < sizeof(FreeNode) ? sizeof(FreeNode) : bytes), blocks(nullptr),
+          freeList(nullptr), unused(nullptr), unusedEnd(nullptr), live(0)
+    {
+        // Keep every node aligned like the block start
+        nodeBytes = (nodeBytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        maxNodesPerBlock = BLOCK_BYTES / nodeBytes > 64 ? BLOCK_BYTES / nodeBytes : 64;
+        nodesPerBlock = FIRST_BLOCK_NODES;
+    }
+
+    // Destructor, frees every block. The owner destroys its nodes first
+    ~NodePool()
+    {
+        releaseBlocks();
+    }
+
+    NodePool(const NodePool &) = delete;
+    NodePool &operator=(const NodePool &) = delete;
+
+    // Move constructor, the blocks and the nodes in them change owner
+    NodePool(NodePool &&other)
+    {
+        takeFrom(other);
+    }
+
+    // Move assignment operator, frees this pool's blocks first
+    NodePool &operator=(NodePool &&other)
+    {
+        if (this != &other)
+        {
+            releaseBlocks();
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    // Uninitialised storage for one node
+    void *allocate()
+    {
+        ++live;
+        if (freeList)
+        {
+            FreeNode *node = freeList;
+            freeList = node->next;
+            return node;
+        }
+
+        if (unused == unusedEnd)
+        {
+            Block *block = static_cast<Block *>(::operator new(sizeof(Block) + nodesPerBlock * nodeBytes));
+            block->next = blocks;
+            block->nodes = nodesPerBlock;
+            blocks = block;
+            unused = reinterpret_cast<char *>(block + 1);
+            unusedEnd = unused + nodesPerBlock * nodeBytes;
+            if (nodesPerBlock < maxNodesPerBlock)
+            {
+                nodesPerBlock = nodesPerBlock * 2 < maxNodesPerBlock ? nodesPerBlock * 2 : maxNodesPerBlock;
+            }
+        }
+        void *node = unused;
+        unused += nodeBytes;
+        return node;
+    }
+
+    // Give a node back, its storage is reused by the next allocate()
+    void release(void *node)
+    {
+        --live;
+        FreeNode *freed = static_cast<FreeNode *>(node);
+        freed->next = freeList;
+        freeList = freed;
+    }
+
+    // Whether the pool holds any block yet
+    bool hasBlocks() const
+    {
+        return blocks != nullptr;
+    }
+
+    // Nodes currently handed out
+    size_t liveNodes() const
+    {
+        return live;
+    }
+
+    // Bytes held in blocks, free nodes included
+    size_t reservedBytes() const
+    {
+        size_t bytes = 0;
+        for (Block *block = blocks; block; block = block->next)
+        {
+            bytes += sizeof(Block) + block->nodes * nodeBytes;
+        }
+        return bytes;
+    }
+};
+
+// Node allocators for LinkedList. A list keeps its own allocator object and
+// calls allocate<Node>() and release<Node>() on it.
+
+// Default: a NodePool of the list's own. No other list allocates from it, so
+// it needs no lock, and its blocks are freed with the list. A copy starts
+// with a new pool, a move takes the pool along with the nodes in it
+class OwnPoolAllocator
+{
+private:
+    NodePool nodes;
+
+public:
+    OwnPoolAllocator() : nodes(0) {}
+
+    OwnPoolAllocator(const OwnPoolAllocator &) : nodes(0) {}
+
+    OwnPoolAllocator(OwnPoolAllocator &&other) : nodes(std::move(other.nodes)) {}
+
+    // Keeps this pool, its nodes still belong to the list
+    OwnPoolAllocator &operator=(const OwnPoolAllocator &)
+    {
+        return *this;
+    }
+
+    OwnPoolAllocator &operator=(OwnPoolAllocator &&other)
+    {
+        nodes = std::move(other.nodes);
+        return *this;
+    }
+
+    template <typename Node>
+    void *allocate()
+    {
+        static_assert(alignof(Node) <= alignof(std::max_align_t), "over-aligned nodes are not pooled");
+        // The node type is only known here, so the pool is sized on first use
+        if (!nodes.hasBlocks())
+        {
+            nodes = NodePool(sizeof(Node));
+        }
+        return nodes.allocate();
+    }
+
+    template <typename Node>
+    void release(void *node)
+    {
+        nodes.release(node);
+    }
+};
+
+// A NodePool owned by someone else, typically shared by all the lists of
+// one container. Nodes must fit the pool's node size
+class PoolAllocator
+{
+private:
+    NodePool *nodes;
+
+public:
+    PoolAllocator(NodePool *pool) : nodes(pool) {}
+
+    template <typename Node>
+    void *allocate()
+    {
+        static_assert(alignof(Node) <= alignof(std::max_align_t), "over-aligned nodes are not pooled");
+        return nodes->allocate();
+    }
+
+    template <typename Node>
+    void release(void *node)
+    {
+        nodes->release(node);
+    }
+};
+
+// A global new and delete per node
+struct HeapAllocator
+{
+    template <typename Node>
+    void *allocate()
+    {
+        return ::operator new(sizeof(Node));
+    }
+
+    template <typename Node>
+    void release(void *node)
+    {
+        ::operator delete(node);
+    }
+};
+
+#endif // NODEPOOL_H
@@ -0,0 +1,139 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <utility>
+
+// Pool of values addressed by integer handles.
+// Values are stored in fixed-size chunks that are never reallocated, so a
+// value keeps its address for as long as its handle is live: growing the slab
+// only adds chunks. Released handles are recycled before new slots are used.
+template <typename T>
+class Slab
+{
+private:
+    static const int CHUNK_BITS = 10;
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+
+    T **chunks;
+    int chunkCount;
+    int chunkCapacity; // entries in chunks
+    int used;          // slots handed out at least once
+    int live;          // slots currently in use
+
+    // Released handles, reused last in first out
+    int *freeHandles;
+    int freeCount;
+    int freeCapacity;
+
+    void addChunk()
+    {
+        if (chunkCount == chunkCapacity)
+        {
+            // Only the chunk pointers move, never the values
+            chunkCapacity = chunkCapacity ? chunkCapacity * 2 : 4;
+            T **grown = new T *[chunkCapacity];
+            for (int i = 0; i < chunkCount; ++i)
+            {
+                grown[i] = chunks[i];
+            }
+            delete[] chunks;
+            chunks = grown;
+        }
+        chunks[chunkCount++] = new T[CHUNK_SIZE];
+    }
+
+public:
+    // Constructor
+    Slab()
+        : chunks(nullptr), chunkCount(0), chunkCapacity(0), used(0), live(0),
+          freeHandles(nullptr), freeCount(0), freeCapacity(0) {}
+
+    // Destructor
+    ~Slab()
+    {
+        for (int i = 0; i < chunkCount; ++i)
+        {
+            delete[] chunks[i];
+        }
+        delete[] chunks;
+        delete[] freeHandles;
+    }
+
+    Slab(const Slab &) = delete;
+    Slab &operator=(const Slab &) = delete;
+
+    // Store a value and return its handle
+    int allocate(const T &value)
+    {
+        int handle = allocate();
+        (*this)[handle] = value;
+        return handle;
+    }
+
+    int allocate(T &&value)
+    {
+        int handle = allocate();
+        (*this)[handle] = std::move(value);
+        return handle;
+    }
+
+    // Handle of a default valued slot
+    int allocate()
+    {
+        int handle;
+        if (freeCount > 0)
+        {
+            handle = freeHandles[--freeCount];
+        }
+        else
+        {
+            if (used == chunkCount * CHUNK_SIZE)
+            {
+                addChunk();
+            }
+            handle = used++;
+        }
+
+        ++live;
+        return handle;
+    }
+
+    // Reset the value and make its handle available again
+    void release(int handle)
+    {
+        if (freeCount == freeCapacity)
+        {
+            freeCapacity = freeCapacity ? freeCapacity * 2 : 16;
+            int *grown = new int[freeCapacity];
+            for (int i = 0; i < freeCount; ++i)
+            {
+                grown[i] = freeHandles[i];
+            }
+            delete[] freeHandles;
+            freeHandles = grown;
+        }
+
+        (*this)[handle] = T();
+        freeHandles[freeCount++] = handle;
+        --live;
+    }
+
+    // Value of a live handle
+    T &operator[](int handle)
+    {
+        return chunks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+    }
+
+    const T &operator[](int handle) const
+    {
+        return chunks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+    }
+
+    // Number of live handles
+    int getSize() const
+    {
+        return live;
+    }
+};
+
+#endif // SLAB_H
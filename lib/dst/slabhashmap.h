@@ -0,0 +1,111 @@
+#ifndef SLABHASHMAP_H
+#define SLABHASHMAP_H
+
+#include "dst/flathashmap.h"
+#include "dst/slab.h"
+
+// Hash map with stable values.
+// Values live in a Slab and the flat table only stores their handles, so
+// rehashing moves small key-handle pairs and never relocates a value. A
+// pointer returned by get(), or a handle returned by insert(), stays valid
+// until its key is removed, which makes it safe to hold across inserts.
+template <typename K, typename V, typename Hash = MixedHash>
+class SlabHashMap
+{
+private:
+    FlatHashMap<K, int, Hash> handles;
+    Slab<V> values;
+
+    // Handle of key, given a default valued slot first if missing
+    int insert_handle(const K &key)
+    {
+        std::pair<int *, bool> found = handles.try_emplace(key, -1);
+        if (found.second)
+        {
+            *found.first = values.allocate();
+        }
+        return *found.first;
+    }
+
+public:
+    // Constructor, sized so expectedSize entries fit without growing
+    SlabHashMap(int expectedSize = 16) : handles(expectedSize) {}
+
+    SlabHashMap(const SlabHashMap &) = delete;
+    SlabHashMap &operator=(const SlabHashMap &) = delete;
+
+    // Insert or update a key-value pair, returns the value's handle
+    int insert(const K &key, const V &value)
+    {
+        int handle = insert_handle(key);
+        values[handle] = value;
+        return handle;
+    }
+
+    int insert(const K &key, V &&value)
+    {
+        int handle = insert_handle(key);
+        values[handle] = std::move(value);
+        return handle;
+    }
+
+    // Value of key, default constructed first if the key is missing
+    V &insert_or_get(const K &key)
+    {
+        return values[insert_handle(key)];
+    }
+
+    // Retrieve a value by key
+    V *get(const K &key)
+    {
+        int *handle = handles.get(key);
+        return handle == nullptr ? nullptr : &values[*handle];
+    }
+
+    // Handle of a key, or -1
+    int find(const K &key)
+    {
+        int *handle = handles.get(key);
+        return handle == nullptr ? -1 : *handle;
+    }
+
+    // Value of a live handle
+    V &at(int handle)
+    {
+        return values[handle];
+    }
+
+    // Remove a key-value pair, its handle may be reused by a later insert
+    bool remove(const K &key)
+    {
+        int *handle = handles.get(key);
+        if (handle == nullptr)
+        {
+            return false;
+        }
+
+        values.release(*handle);
+        handles.remove(key);
+        return true;
+    }
+
+    // Get current size of the hash map
+    int getSize() const
+    {
+        return handles.getSize();
+    }
+
+    // Check if hash map is empty
+    bool isEmpty() const
+    {
+        return handles.isEmpty();
+    }
+
+    // Occupancy of the handle table
+    HashStats stats() const
+    {
+        return handles.stats();
+    }
+};
+
+#endif // SLABHASHMAP_H
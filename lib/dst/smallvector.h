@@ -0,0 +1,226 @@
+#ifndef SMALLVECTOR_H
+#define SMALLVECTOR_H
+
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+// Growable array that keeps its first N elements inline.
+// Short lists, which are the common case for adjacency, need no heap
+// allocation at all; longer ones move to one heap array that doubles as it
+// grows. Elements are always contiguous, so iteration is a linear scan.
+// Same push_back/remove/contain/begin/end surface as LinkedList.
+template <typename T, int N = 8>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector moves elements with memcpy");
+
+private:
+    T *items; // inlineItems, or a malloc'd array once grown
+    int size;
+    int capacity;
+    T inlineItems[N];
+
+    bool isInline() const
+    {
+        return items == inlineItems;
+    }
+
+    void copyFrom(const SmallVector &other)
+    {
+        if (other.size > N)
+        {
+            capacity = other.size;
+            items = static_cast<T *>(malloc(capacity * sizeof(T)));
+        }
+        size = other.size;
+        memcpy(items, other.items, size * sizeof(T));
+    }
+
+    // Take other's elements, leaving it empty
+    void moveFrom(SmallVector &other)
+    {
+        if (other.isInline())
+        {
+            memcpy(items, other.items, other.size * sizeof(T));
+        }
+        else
+        {
+            items = other.items;
+            capacity = other.capacity;
+            other.items = other.inlineItems;
+            other.capacity = N;
+        }
+        size = other.size;
+        other.size = 0;
+    }
+
+    void release()
+    {
+        if (!isInline())
+        {
+            free(items);
+        }
+        items = inlineItems;
+        size = 0;
+        capacity = N;
+    }
+
+public:
+    // Constructor
+    SmallVector() : items(inlineItems), size(0), capacity(N) {}
+
+    // Destructor
+    ~SmallVector()
+    {
+        release();
+    }
+
+    SmallVector(const SmallVector &other) : items(inlineItems), size(0), capacity(N)
+    {
+        copyFrom(other);
+    }
+
+    SmallVector(SmallVector &&other) : items(inlineItems), size(0), capacity(N)
+    {
+        moveFrom(other);
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if (this != &other)
+        {
+            release();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other)
+    {
+        if (this != &other)
+        {
+            release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    // Make room for count elements without further allocation
+    void reserve(int count)
+    {
+        if (count <= capacity)
+        {
+            return;
+        }
+
+        if (isInline())
+        {
+            T *grown = static_cast<T *>(malloc(count * sizeof(T)));
+            memcpy(grown, items, size * sizeof(T));
+            items = grown;
+        }
+        else
+        {
+            items = static_cast<T *>(realloc(items, count * sizeof(T)));
+        }
+        capacity = count;
+    }
+
+    // Add element to the end
+    void push_back(const T &value)
+    {
+        if (size == capacity)
+        {
+            reserve(capacity * 2);
+        }
+        items[size++] = value;
+    }
+
+    // Insert before position index, shifting later elements up
+    void insert(int index, const T &value)
+    {
+        if (size == capacity)
+        {
+            reserve(capacity * 2);
+        }
+        memmove(items + index + 1, items + index, (size - index) * sizeof(T));
+        items[index] = value;
+        ++size;
+    }
+
+    // Remove the element at position index, keeping the order of the rest
+    void erase(int index)
+    {
+        memmove(items + index, items + index + 1, (size - index - 1) * sizeof(T));
+        --size;
+    }
+
+    // Remove the first copy of target, keeping the order of the rest
+    bool remove(const T &target)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            if (items[i] == target)
+            {
+                erase(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contain(const T &target) const
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            if (items[i] == target)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Remove every element, keeping any heap array
+    void clear()
+    {
+        size = 0;
+    }
+
+    T &operator[](int index)
+    {
+        return items[index];
+    }
+
+    const T &operator[](int index) const
+    {
+        return items[index];
+    }
+
+    // Check if empty
+    bool empty() const
+    {
+        return size == 0;
+    }
+
+    // Get current number of elements
+    int getSize() const
+    {
+        return size;
+    }
+
+    // Bytes allocated outside the object itself
+    size_t heapBytes() const
+    {
+        return isInline() ? 0 : capacity * sizeof(T);
+    }
+
+    // Iteration, pointers stay valid until the next push_back or move
+    T *begin() { return items; }
+    T *end() { return items + size; }
+    const T *begin() const { return items; }
+    const T *end() const { return items + size; }
+};
+
+#endif // SMALLVECTOR_H
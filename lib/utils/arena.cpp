@@ -0,0 +1,72 @@
+#include "utils/arena.h"
+
+#include <cstdlib>
+#include <cstring>
+
+StringArena::StringArena(size_t blockSize) : head(nullptr), blockSize(blockSize), bytes(0) {}
+
+StringArena::~StringArena() {
+    clear();
+}
+
+StringArena::Block* StringArena::newBlock(size_t minSize) {
+    size_t size = minSize > blockSize ? minSize : blockSize;
+    Block* block = static_cast<Block*>(malloc(sizeof(Block) + size));
+    if(!block) throw "Arena allocation failed";
+
+    block->size = size;
+    block->used = 0;
+    block->next = head;
+    head = block;
+    return block;
+}
+
+char* StringArena::allocate(size_t length) {
+    Block* block = head;
+    if(!block || block->size - block->used < length) block = newBlock(length);
+
+    char* p = block->data() + block->used;
+    block->used += length;
+    bytes += length;
+    return p;
+}
+
+char* StringArena::copy(const char* s, size_t length) {
+    char* d = allocate(length + 1);
+    memcpy(d, s, length);
+    d[length] = '\0';
+    return d;
+}
+
+char* StringArena::copy(const char* s) {
+    return copy(s, strlen(s));
+}
+
+void StringArena::adopt(StringArena& other) {
+    if(!other.head) return;
+
+    // Keep our current block in front so its free space is still used
+    Block* tail = other.head;
+    while(tail->next) tail = tail->next;
+
+    if(head) {
+        tail->next = head->next;
+        head->next = other.head;
+    }
+    else {
+        head = other.head;
+    }
+
+    bytes += other.bytes;
+    other.head = nullptr;
+    other.bytes = 0;
+}
+
+void StringArena::clear() {
+    while(head) {
+        Block* next = head->next;
+        free(head);
+        head = next;
+    }
+    bytes = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+
+// Bump-pointer storage for strings that share one lifetime.
+// Strings are packed into large blocks and released together, so there is
+// no per-string allocation or free. Not thread-safe; use one arena per thread
+// and adopt() them into a single owner afterwards.
+class StringArena
+{
+private:
+    struct Block
+    {
+        Block *next;
+        size_t size;
+        size_t used;
+        char *data() { return reinterpret_cast<char *>(this + 1); }
+    };
+
+    Block *head; // current block, older blocks follow through next
+    size_t blockSize;
+    size_t bytes;
+
+    Block *newBlock(size_t minSize);
+
+public:
+    StringArena(size_t blockSize = 1 << 20);
+    ~StringArena();
+
+    StringArena(const StringArena &) = delete;
+    StringArena &operator=(const StringArena &) = delete;
+
+    // Reserve length bytes (not null-terminated)
+    char *allocate(size_t length);
+
+    // Copy a string into the arena and null-terminate it
+    char *copy(const char *s, size_t length);
+    char *copy(const char *s);
+
+    // Take ownership of all blocks of another arena, leaving it empty
+    void adopt(StringArena &other);
+
+    // Release every block at once
+    void clear();
+
+    // Bytes handed out so far
+    size_t size() const { return bytes; }
+};
+
+#endif // ARENA_H
@@ -1,10 +1,21 @@
 #include "utils/csvparser.h"
+#include "utils/csvscan.h"
 
 #include "classes/actor.h"
 #include "classes/movie.h"
 #include "classes/actor-movie.h"
 
+#include <charconv>
+#include <climits>
 #include <cstring>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace CSVParser {
     namespace detail {
@@ -17,11 +28,20 @@ namespace CSVParser {
         char** parseLine(const char* line, int& colCount) {
             char** cols = nullptr;
             colCount = 0;
-            char* buffer = static_cast<char*>(malloc(strlen(line) + 1));
+            size_t length = strlen(line);
+            const char* end = line + length;
+            char* buffer = static_cast<char*>(malloc(length + 1));
             size_t bufIndex = 0;
             bool inQuotes = false;
 
-            for(const char* p = line; *p; p++) {
+            for(const char* p = line; p < end; p++) {
+                // Copy the run of ordinary characters in one go
+                const char* special = findSpecial(p, end);
+                memcpy(buffer + bufIndex, p, special - p);
+                bufIndex += special - p;
+                p = special;
+                if(p == end) break;
+
                 if(*p == '"') {
                     inQuotes = !inQuotes;
                 }
@@ -50,15 +70,402 @@ namespace CSVParser {
             free(cols);
         }
 
-        int convertInt(const char* s) { return atoi(s); }
+        int convertInt(const char* s) {
+            int value;
+            return parseInt(s, s + strlen(s), value) ? value : 0;
+        }
         double convertDouble(const char* s) { return atof(s); }
-        char* convertString(const char* s) { return strdup(s); }
+        char* convertString(const char* s, StringArena* arena) { return arena ? arena->copy(s) : strdup(s); }
+
+        void mapFile(const char* filename, MappedFile& file) {
+            int fd = open(filename, O_RDONLY);
+            if(fd < 0) throw "File open failed";
+
+            struct stat st;
+            if(fstat(fd, &st) != 0) {
+                close(fd);
+                throw "File open failed";
+            }
+
+            file.size = static_cast<size_t>(st.st_size);
+            file.data = nullptr;
+            if(file.size > 0) {
+                void* addr = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(addr == MAP_FAILED) {
+                    close(fd);
+                    throw "File map failed";
+                }
+                madvise(addr, file.size, MADV_SEQUENTIAL);
+                file.data = static_cast<const char*>(addr);
+            }
+
+            // The mapping stays valid after the descriptor is closed
+            close(fd);
+        }
+
+        void unmapFile(MappedFile& file) {
+            if(file.data) munmap(const_cast<char*>(file.data), file.size);
+            file.data = nullptr;
+            file.size = 0;
+        }
+
+        int parseRecord(const char*& p, const char* end, Field* cols, int maxCols) {
+            int colCount = 0;
+            const char* start = p;
+            bool quoted = false;
+            bool inQuotes = false;
+
+            while(p < end) {
+                p = findSpecial(p, end);
+                if(p == end) break;
+
+                char c = *p;
+                if(c == '"') {
+                    inQuotes = !inQuotes;
+                    quoted = true;
+                }
+                else if(!inQuotes) {
+                    if(c != ',') break;
+                    if(colCount < maxCols) cols[colCount] = Field{start, static_cast<size_t>(p - start), quoted};
+                    colCount++;
+                    start = p + 1;
+                    quoted = false;
+                }
+                p++;
+            }
+
+            // Add last column
+            if(colCount < maxCols) cols[colCount] = Field{start, static_cast<size_t>(p - start), quoted};
+            colCount++;
+
+            // Skip the line terminator ("\n" or "\r\n")
+            if(p < end && *p == '\r') p++;
+            if(p < end && *p == '\n') p++;
+
+            // Missing trailing columns read as empty fields
+            for(int i = colCount; i < maxCols; i++) cols[i] = Field{p, 0, false};
+            return colCount;
+        }
+
+        size_t splitChunks(const char* begin, const char* end, size_t count, const char** bounds) {
+            // Chunks below this size are not worth a thread
+            const size_t minChunk = 1 << 16;
+            size_t length = static_cast<size_t>(end - begin);
+            if(count > length / minChunk) count = length / minChunk;
+            if(count < 1) count = 1;
+
+            bounds[0] = begin;
+            if(count == 1) {
+                bounds[1] = end;
+                return 1;
+            }
+
+            // Quote parity of each raw (unaligned) chunk, counted in parallel
+            const char** raw = new const char*[count + 1];
+            bool* odd = new bool[count];
+            for(size_t i = 0; i <= count; i++) raw[i] = begin + length * i / count;
+
+            std::thread* workers = new std::thread[count];
+            for(size_t i = 0; i < count; i++) {
+                workers[i] = std::thread([raw, odd, i]() {
+                    size_t quotes = 0;
+                    for(const char* p = raw[i]; p < raw[i + 1]; p++) quotes += (*p == '"');
+                    odd[i] = quotes & 1;
+                });
+            }
+            for(size_t i = 0; i < count; i++) workers[i].join();
+            delete[] workers;
+
+            // Move each split point to the start of the next record outside quotes
+            size_t chunks = 1;
+            bool inQuotes = false;
+            for(size_t i = 1; i < count; i++) {
+                inQuotes ^= odd[i - 1];
+
+                const char* p = raw[i];
+                bool quoted = inQuotes;
+                while(p < end && (quoted || *p != '\n')) {
+                    if(*p == '"') quoted = !quoted;
+                    p++;
+                }
+                if(p < end) p++;
+
+                if(p > bounds[chunks - 1] && p < end) bounds[chunks++] = p;
+            }
+            bounds[chunks] = end;
+
+            delete[] raw;
+            delete[] odd;
+            return chunks;
+        }
+
+        size_t countLines(const char* begin, const char* end) {
+            size_t lines = 0;
+            const char* p = begin;
+            while(p < end && (p = static_cast<const char*>(memchr(p, '\n', end - p)))) {
+                lines++;
+                p++;
+            }
+            return lines;
+        }
+
+        // Convert 1 to 8 ASCII digits with SWAR arithmetic on one 64-bit word
+        static inline uint32_t parseDigits(const char* digits, size_t len) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            uint32_t value = 0;
+            for(size_t i = 0; i < len; i++) value = value * 10 + (digits[i] - '0');
+            return value;
+#else
+            // Right-align the digits in a word padded with '0'
+            char buffer[8] = {'0', '0', '0', '0', '0', '0', '0', '0'};
+            memcpy(buffer + 8 - len, digits, len);
+            uint64_t val;
+            memcpy(&val, buffer, sizeof(val));
+
+            // Combine adjacent digits into pairs, then quads, then all eight
+            val = (val & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+            val = (val & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+            return static_cast<uint32_t>((val & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32);
+#endif
+        }
+
+        bool parseInt(const char* p, const char* last, int& value) {
+            value = 0;
+            while(p < last && (*p == ' ' || *p == '"')) p++;
+
+            bool negative = false;
+            if(p < last && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+            const char* digits = p;
+            while(p < last && static_cast<unsigned>(*p - '0') < 10) p++;
+            size_t len = static_cast<size_t>(p - digits);
+            if(len == 0) return false;
+
+            if(len <= 8) {
+                int magnitude = static_cast<int>(parseDigits(digits, len));
+                value = negative ? -magnitude : magnitude;
+                return true;
+            }
+
+            // Longer runs may overflow, let from_chars range-check them
+            long long wide = 0;
+            std::from_chars_result r = std::from_chars(digits, p, wide);
+            if(r.ec != std::errc() || wide > static_cast<long long>(INT_MAX) + negative) return false;
+            value = static_cast<int>(negative ? -wide : wide);
+            return true;
+        }
+
+        bool parseIntRecord(const char*& p, const char* end, int* values, int n) {
+            const char* q = p;
+            for(int i = 0; i < n; i++) {
+                bool negative = false;
+                if(q < end && *q == '-') {
+                    negative = true;
+                    q++;
+                }
+
+                const char* digits = q;
+                while(q < end && static_cast<unsigned>(*q - '0') < 10) q++;
+                size_t len = static_cast<size_t>(q - digits);
+                if(len == 0 || len > 8) return false;
+
+                int magnitude = static_cast<int>(parseDigits(digits, len));
+                values[i] = negative ? -magnitude : magnitude;
+
+                if(i < n - 1) {
+                    if(q >= end || *q != ',') return false;
+                    q++;
+                }
+            }
+
+            // Extra columns, quotes or padding go through the general parser
+            if(q < end && *q != '\n' && *q != '\r') return false;
+            if(q < end && *q == '\r') q++;
+            if(q < end && *q == '\n') q++;
+            p = q;
+            return true;
+        }
+
+        int convertInt(const Field& f) {
+            int value;
+            return parseInt(f.data, f.data + f.length, value) ? value : 0;
+        }
+
+        double convertDouble(const Field& f) {
+            char buffer[64];
+            size_t len = 0;
+            for(size_t i = 0; i < f.length && len < sizeof(buffer) - 1; i++) {
+                if(f.data[i] != '"') buffer[len++] = f.data[i];
+            }
+            buffer[len] = '\0';
+            return atof(buffer);
+        }
+
+        char* convertString(const Field& f, StringArena* arena) {
+            char* d = arena ? arena->allocate(f.length + 1) : static_cast<char*>(malloc(f.length + 1));
+            if(!d) return d;
+
+            if(!f.quoted) {
+                memcpy(d, f.data, f.length);
+                d[f.length] = '\0';
+                return d;
+            }
+
+            // Strip quote characters, matching parseLine
+            size_t len = 0;
+            for(size_t i = 0; i < f.length; i++) {
+                if(f.data[i] != '"') d[len++] = f.data[i];
+            }
+            d[len] = '\0';
+            return d;
+        }
+
+        LazyString convertLazy(const char* s, const Options& options, int column) {
+            LazyString lazy = LazyString();
+            if(options.load(column)) lazy.value = convertString(s, options.arena);
+            return lazy;
+        }
+
+        LazyString convertLazy(const Field& f, const Options& options, int column) {
+            LazyString lazy = LazyString();
+            if(!options.load(column)) return lazy;
+
+            if(options.lazy(column)) {
+                lazy.offset = static_cast<size_t>(f.data - options.source->data());
+                lazy.length = static_cast<uint32_t>(f.length);
+                lazy.quoted = f.quoted;
+            }
+            else {
+                lazy.value = convertString(f, options.arena);
+            }
+            return lazy;
+        }
+    }
+
+    const char* Fetch(LazyString& s, const Source* source, StringArena* arena) {
+        if(s.value) return s.value;
+        if(s.length == 0 || !source || s.offset + s.length > source->size()) return "";
+
+        Field f = Field{source->data() + s.offset, s.length, s.quoted};
+        s.value = detail::convertString(f, arena);
+        return s.value;
     }
 }
 
 // Template implementations
+namespace CSVParser {
+    namespace detail {
+        // Grow a results array to exactly `wanted` rows
+        template<typename T>
+        void reserveResults(T*& results, size_t& capacity, size_t wanted) {
+            if(wanted <= capacity) return;
+            results = static_cast<T*>(realloc(results, wanted * sizeof(T)));
+            capacity = wanted;
+        }
+
+        // Append a row, doubling capacity so appends stay amortised O(1)
+        template<typename T>
+        void appendResult(T*& results, size_t& count, size_t& capacity, const T& obj) {
+            if(count == capacity) reserveResults(results, capacity, capacity ? capacity * 2 : 64);
+            results[count++] = obj;
+        }
+
+        // Release unused capacity so FreeResults sees a tight array
+        template<typename T>
+        void shrinkResults(T*& results, size_t count, size_t capacity) {
+            if(count == capacity) return;
+            if(count == 0) {
+                free(results);
+                results = nullptr;
+                return;
+            }
+            results = static_cast<T*>(realloc(results, count * sizeof(T)));
+        }
+
+        // Traits with `numeric = true` take every column as an int via applyInts
+        template<typename T, typename = void>
+        struct IsNumeric : std::false_type {};
+
+        template<typename T>
+        struct IsNumeric<T, std::void_t<decltype(Traits<T>::numeric)>>
+            : std::integral_constant<bool, Traits<T>::numeric> {};
+
+        // Parse the row at p into obj, returns false for blank lines
+        template<typename T>
+        bool parseRow(const char*& p, const char* end, const Options& options, T& obj) {
+            if(*p == '\n' || *p == '\r') {
+                p++;
+                return false;
+            }
+
+            // All-integer rows skip the column views entirely
+            if constexpr (IsNumeric<T>::value) {
+                int values[Traits<T>::columns];
+                if(parseIntRecord(p, end, values, Traits<T>::columns)) {
+                    Traits<T>::applyInts(obj, values);
+                    return true;
+                }
+            }
+
+            Field cols[Traits<T>::columns];
+            parseRecord(p, end, cols, Traits<T>::columns);
+            int currentCol = 0;
+
+            Traits<T>::apply(obj, cols, currentCol, options);
+            return true;
+        }
+
+        template<typename T>
+        void parseChunk(const char* p, const char* end, size_t capacity, const Options& options,
+                        T*& results, size_t& count) {
+            results = nullptr;
+            count = 0;
+
+            // Pre-size from the hint, or from the number of line breaks in the chunk
+            if(capacity == 0) capacity = countLines(p, end) + 1;
+            size_t allocated = 0;
+            reserveResults(results, allocated, capacity);
+
+            T obj;
+            while(p < end) {
+                // Add to results array
+                if(parseRow(p, end, options, obj)) appendResult(results, count, allocated, obj);
+            }
+
+            shrinkResults(results, count, allocated);
+        }
+
+        // Map the file (or reuse options.source) and return the first byte after the header
+        const char* openBody(const char* filename, const Options& options, MappedFile& file) {
+            // Lazy columns need the mapping to stay open in options.source
+            if(options.source) {
+                if(!options.source->isOpen()) options.source->open(filename);
+                file = MappedFile{options.source->data(), options.source->size()};
+            }
+            else {
+                mapFile(filename, file);
+            }
+
+            const char* p = file.data;
+            const char* end = file.data + file.size;
+
+            // Skip header line
+            p = p ? static_cast<const char*>(memchr(p, '\n', end - p)) : nullptr;
+            if(!p) {
+                closeBody(options, file);
+                throw "File contains no data after header";
+            }
+            return p + 1;
+        }
+
+        void closeBody(const Options& options, MappedFile& file) {
+            if(!options.source) unmapFile(file);
+        }
+    }
+}
+
 template<typename T>
-T* CSVParser::Parse(const char* filename, size_t* outCount) {
+T* CSVParser::Parse(const char* filename, size_t* outCount, size_t capacityHint) {
     using namespace CSVParser::detail;
     
     FILE* file = fopen(filename, "r");
@@ -66,6 +473,7 @@ T* CSVParser::Parse(const char* filename, size_t* outCount) {
 
     T* results = nullptr;
     size_t count = 0;
+    size_t capacity = 0;
     char line[4096];
 
     // Skip header line
@@ -74,6 +482,15 @@ T* CSVParser::Parse(const char* filename, size_t* outCount) {
         throw "File contains no data after header";
     }
 
+    // Rows sampled before estimating the total from the file size
+    const size_t sampleRows = 64;
+    long dataStart = ftell(file);
+    long dataSize = 0;
+    if(fseek(file, 0, SEEK_END) == 0) dataSize = ftell(file) - dataStart;
+    fseek(file, dataStart, SEEK_SET);
+
+    reserveResults(results, capacity, capacityHint);
+
     while(fgets(line, sizeof(line), file)) {
         // Remove newline characters
         line[strcspn(line, "\r\n")] = 0;
@@ -83,33 +500,151 @@ T* CSVParser::Parse(const char* filename, size_t* outCount) {
         T obj;
         int currentCol = 0;
 
-        Traits<T>::apply(obj, cols, currentCol);
+        Traits<T>::apply(obj, cols, currentCol, Options());
 
         // Add to results array
-        results = static_cast<T*>(realloc(results, (count + 1) * sizeof(T)));
-        results[count++] = obj;
+        appendResult(results, count, capacity, obj);
 
         freeColumns(cols, colCount);
+
+        // Estimate the row count from the average sampled line length
+        if(count == sampleRows && capacityHint == 0 && dataSize > 0) {
+            long sampled = ftell(file) - dataStart;
+            if(sampled > 0) reserveResults(results, capacity, static_cast<size_t>(dataSize / (double)sampled * count * 1.05) + 1);
+        }
     }
 
+    shrinkResults(results, count, capacity);
     fclose(file);
     *outCount = count;
     return results;
 }
 
 template<typename T>
-void CSVParser::FreeResults(T* data, size_t count) {
-    for(size_t i = 0; i < count; i++) {
-        Traits<T>::free(data[i]);
+T* CSVParser::ParseMapped(const char* filename, size_t* outCount, const Options& options) {
+    using namespace CSVParser::detail;
+
+    MappedFile file;
+    const char* p = openBody(filename, options, file);
+    const char* end = file.data + file.size;
+
+    size_t threads = options.threads;
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    if(threads == 0) threads = 1;
+
+    const char** bounds = new const char*[threads + 1];
+    size_t chunks = splitChunks(p, end, threads, bounds);
+
+    T* results = nullptr;
+    size_t count = 0;
+
+    if(chunks == 1) {
+        parseChunk<T>(bounds[0], bounds[1], options.capacityHint, options, results, count);
+    }
+    else {
+        // Parse each chunk into its own block, then join the blocks in order
+        T** blocks = new T*[chunks];
+        size_t* counts = new size_t[chunks];
+        std::thread* workers = new std::thread[chunks];
+
+        // Arenas are single-threaded, so each chunk fills its own
+        StringArena* arenas = options.arena ? new StringArena[chunks] : nullptr;
+        Options* chunkOptions = new Options[chunks];
+
+        for(size_t i = 0; i < chunks; i++) {
+            // Share of the hint proportional to the chunk size
+            size_t capacity = 0;
+            if(options.capacityHint > 0) {
+                capacity = static_cast<size_t>((double)options.capacityHint * (bounds[i + 1] - bounds[i]) / (end - p)) + 1;
+            }
+            chunkOptions[i] = options;
+            if(arenas) chunkOptions[i].arena = &arenas[i];
+            workers[i] = std::thread(parseChunk<T>, bounds[i], bounds[i + 1], capacity, std::cref(chunkOptions[i]),
+                                     std::ref(blocks[i]), std::ref(counts[i]));
+        }
+        for(size_t i = 0; i < chunks; i++) {
+            workers[i].join();
+            count += counts[i];
+        }
+
+        results = static_cast<T*>(malloc(count * sizeof(T)));
+        size_t offset = 0;
+        for(size_t i = 0; i < chunks; i++) {
+            if(counts[i] > 0) memcpy(results + offset, blocks[i], counts[i] * sizeof(T));
+            offset += counts[i];
+            free(blocks[i]);
+            if(arenas) options.arena->adopt(arenas[i]);
+        }
+
+        delete[] arenas;
+        delete[] chunkOptions;
+        delete[] workers;
+        delete[] blocks;
+        delete[] counts;
+    }
+
+    delete[] bounds;
+    closeBody(options, file);
+    *outCount = count;
+    return results;
+}
+
+template<typename T>
+size_t CSVParser::ForEach(const char* filename, Sink<T> sink, void* context, const Options& options) {
+    using namespace CSVParser::detail;
+
+    MappedFile file;
+    const char* p = openBody(filename, options, file);
+    const char* end = file.data + file.size;
+
+    // Only one batch of rows is ever materialised
+    const size_t batchRows = 4096;
+    T* batch = static_cast<T*>(malloc(batchRows * sizeof(T)));
+    size_t inBatch = 0;
+    size_t total = 0;
+
+    while(p < end) {
+        if(!parseRow(p, end, options, batch[inBatch])) continue;
+        if(++inBatch == batchRows) {
+            sink(batch, inBatch, context);
+            total += inBatch;
+            inBatch = 0;
+        }
+    }
+
+    if(inBatch > 0) sink(batch, inBatch, context);
+    total += inBatch;
+
+    free(batch);
+    closeBody(options, file);
+    return total;
+}
+
+template<typename T>
+void CSVParser::FreeResults(T* data, size_t count, const Options& options) {
+    // Arena-backed strings are released together
+    if(options.arena) {
+        options.arena->clear();
+    }
+    else {
+        for(size_t i = 0; i < count; i++) {
+            Traits<T>::free(data[i]);
+        }
     }
     free(data);
 }
 
-template Actor* CSVParser::Parse<Actor>(const char*, size_t*);
-template void CSVParser::FreeResults<Actor>(Actor*, size_t);
+template Actor* CSVParser::Parse<Actor>(const char*, size_t*, size_t);
+template Actor* CSVParser::ParseMapped<Actor>(const char*, size_t*, const CSVParser::Options&);
+template size_t CSVParser::ForEach<Actor>(const char*, CSVParser::Sink<Actor>, void*, const CSVParser::Options&);
+template void CSVParser::FreeResults<Actor>(Actor*, size_t, const CSVParser::Options&);
 
-template Movie* CSVParser::Parse<Movie>(const char*, size_t*);
-template void CSVParser::FreeResults<Movie>(Movie*, size_t);
+template Movie* CSVParser::Parse<Movie>(const char*, size_t*, size_t);
+template Movie* CSVParser::ParseMapped<Movie>(const char*, size_t*, const CSVParser::Options&);
+template size_t CSVParser::ForEach<Movie>(const char*, CSVParser::Sink<Movie>, void*, const CSVParser::Options&);
+template void CSVParser::FreeResults<Movie>(Movie*, size_t, const CSVParser::Options&);
 
-template ActorMovie* CSVParser::Parse<ActorMovie>(const char*, size_t*);
-template void CSVParser::FreeResults<ActorMovie>(ActorMovie*, size_t);
+template ActorMovie* CSVParser::Parse<ActorMovie>(const char*, size_t*, size_t);
+template ActorMovie* CSVParser::ParseMapped<ActorMovie>(const char*, size_t*, const CSVParser::Options&);
+template size_t CSVParser::ForEach<ActorMovie>(const char*, CSVParser::Sink<ActorMovie>, void*, const CSVParser::Options&);
+template void CSVParser::FreeResults<ActorMovie>(ActorMovie*, size_t, const CSVParser::Options&);
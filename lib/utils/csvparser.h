@@ -3,47 +3,163 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
+
+#include "utils/arena.h"
 
 namespace CSVParser {
     // Main template interface
     template<typename T>
     struct Traits;
     
+    // View of a single field inside a mapped file
+    struct Field {
+        const char* data;
+        size_t length;
+        bool quoted; // field still contains '"' characters to be stripped
+    };
+
+    // String column that can stay in the source file until first access
+    struct LazyString {
+        char* value;      // materialised string, nullptr until fetched
+        size_t offset;    // byte offset of the raw field in the source file
+        uint32_t length;  // raw field length, 0 = empty or not loaded
+        bool quoted;
+    };
+
+    class Source;
+
+    // Options for the mapped parser
+    struct Options {
+        unsigned threads = 1;     // worker threads, 0 = one per hardware thread
+        size_t capacityHint = 0;  // expected row count, 0 = count line breaks
+        StringArena* arena = nullptr; // string storage, nullptr = malloc each string
+
+        // Column projection, bit i refers to column i of Traits<T>
+        unsigned columns = ~0u;   // columns to load, others are left empty
+        unsigned lazyColumns = 0; // LazyString columns fetched from source on access
+        Source* source = nullptr; // keeps the file mapped for lazy columns
+
+        bool load(int column) const { return columns & (1u << column); }
+        bool lazy(int column) const { return (lazyColumns & (1u << column)) && source; }
+    };
+
     // Primary parse function
     template<typename T>
-    T* Parse(const char* filename, size_t* outCount);
+    T* Parse(const char* filename, size_t* outCount, size_t capacityHint = 0);
+
+    // Zero-copy parse function (fields are views into the memory-mapped file)
+    template<typename T>
+    T* ParseMapped(const char* filename, size_t* outCount, const Options& options = Options());
+
+    // Receives parsed rows in batches; the rows are only valid during the call
+    template<typename T>
+    using Sink = void (*)(const T* rows, size_t count, void* context);
+
+    // Streaming parse function: hands rows to sink in file order, one batch at
+    // a time, without building a result array. Returns the number of rows.
+    // Runs on the calling thread, options.threads is ignored
+    template<typename T>
+    size_t ForEach(const char* filename, Sink<T> sink, void* context, const Options& options = Options());
     
-    // Memory cleanup function
+    // Memory cleanup function, pass the options used to parse (clears options.arena)
     template<typename T>
-    void FreeResults(T* data, size_t count);
+    void FreeResults(T* data, size_t count, const Options& options = Options());
     
     // Implementation namespace
     namespace detail {
         // String duplication
         char* strdup(const char* s);
         
+        // Read-only file mapping
+        struct MappedFile {
+            const char* data;
+            size_t size;
+        };
+        void mapFile(const char* filename, MappedFile& file);
+        void unmapFile(MappedFile& file);
+
         // Line parsing
         char** parseLine(const char* line, int& colCount);
         void freeColumns(char** cols, int count);
+
+        // Record parsing over a mapped range, advances p past the record
+        int parseRecord(const char*& p, const char* end, Field* cols, int maxCols);
+
+        // Split [begin, end) into newline-aligned chunks outside quoted fields,
+        // writes count + 1 boundaries and returns the number of chunks
+        size_t splitChunks(const char* begin, const char* end, size_t count, const char** bounds);
+
+        // Number of line breaks in [begin, end), used to pre-size results
+        size_t countLines(const char* begin, const char* end);
+
+        // Map a file for parsing and skip its header, then release it
+        const char* openBody(const char* filename, const Options& options, MappedFile& file);
+        void closeBody(const Options& options, MappedFile& file);
         
+        // Integer parsing: skips leading spaces and quotes, returns false when
+        // there are no digits or the value does not fit in an int
+        bool parseInt(const char* first, const char* last, int& value);
+
+        // Parse a record of n integer columns straight into values. Returns
+        // false and leaves p unchanged for rows that need parseRecord
+        bool parseIntRecord(const char*& p, const char* end, int* values, int n);
+
         // Type conversions
         int convertInt(const char* s);
         double convertDouble(const char* s);
-        char* convertString(const char* s);
+        char* convertString(const char* s, StringArena* arena = nullptr);
+
+        int convertInt(const Field& f);
+        double convertDouble(const Field& f);
+        char* convertString(const Field& f, StringArena* arena = nullptr);
+
+        // Lazy columns record where the field is, other paths load it eagerly
+        LazyString convertLazy(const char* s, const Options& options, int column);
+        LazyString convertLazy(const Field& f, const Options& options, int column);
     }
+
+    // Mapped source file that outlives the parse, for lazy columns
+    class Source {
+    private:
+        detail::MappedFile file;
+
+    public:
+        Source() : file{nullptr, 0} {}
+        ~Source() { close(); }
+
+        Source(const Source&) = delete;
+        Source& operator=(const Source&) = delete;
+
+        void open(const char* filename) { close(); detail::mapFile(filename, file); }
+        void close() { detail::unmapFile(file); }
+
+        bool isOpen() const { return file.data != nullptr; }
+        const char* data() const { return file.data; }
+        size_t size() const { return file.size; }
+    };
+
+    // Materialise a lazy column on first access and cache it
+    const char* Fetch(LazyString& s, const Source* source, StringArena* arena = nullptr);
 }
 
 struct Actor;
 struct Movie;
 struct ActorMovie;
 
-extern template Actor* CSVParser::Parse<Actor>(const char*, size_t*);
-extern template void CSVParser::FreeResults<Actor>(Actor*, size_t);
+extern template Actor* CSVParser::Parse<Actor>(const char*, size_t*, size_t);
+extern template Actor* CSVParser::ParseMapped<Actor>(const char*, size_t*, const CSVParser::Options&);
+extern template size_t CSVParser::ForEach<Actor>(const char*, CSVParser::Sink<Actor>, void*, const CSVParser::Options&);
+extern template void CSVParser::FreeResults<Actor>(Actor*, size_t, const CSVParser::Options&);
 
-extern template Movie* CSVParser::Parse<Movie>(const char*, size_t*);
-extern template void CSVParser::FreeResults<Movie>(Movie*, size_t);
+extern template Movie* CSVParser::Parse<Movie>(const char*, size_t*, size_t);
+extern template Movie* CSVParser::ParseMapped<Movie>(const char*, size_t*, const CSVParser::Options&);
+extern template size_t CSVParser::ForEach<Movie>(const char*, CSVParser::Sink<Movie>, void*, const CSVParser::Options&);
+extern template void CSVParser::FreeResults<Movie>(Movie*, size_t, const CSVParser::Options&);
 
-extern template ActorMovie* CSVParser::Parse<ActorMovie>(const char*, size_t*);
-extern template void CSVParser::FreeResults<ActorMovie>(ActorMovie*, size_t);
+extern template ActorMovie* CSVParser::Parse<ActorMovie>(const char*, size_t*, size_t);
+extern template ActorMovie* CSVParser::ParseMapped<ActorMovie>(const char*, size_t*, const CSVParser::Options&);
+extern template size_t CSVParser::ForEach<ActorMovie>(const char*, CSVParser::Sink<ActorMovie>, void*, const CSVParser::Options&);
+extern template void CSVParser::FreeResults<ActorMovie>(ActorMovie*, size_t, const CSVParser::Options&);
 
 #endif // CSV_PARSER_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "utils/csvscan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define CSV_SCAN_X86
+    #include <immintrin.h>
+#endif
+
+namespace CSVParser {
+    namespace detail {
+        static inline bool isSpecial(char c) {
+            return c == '"' || c == ',' || c == '\n' || c == '\r';
+        }
+
+        const char* findSpecialScalar(const char* p, const char* end) {
+            while(p < end && !isSpecial(*p)) p++;
+            return p;
+        }
+
+#ifdef CSV_SCAN_X86
+        // One mask bit per special character in the 16 bytes at p
+        __attribute__((target("sse2")))
+        static inline unsigned specialMask16(const char* p) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                                     _mm_cmpeq_epi8(v, _mm_set1_epi8(','))),
+                                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+            return static_cast<unsigned>(_mm_movemask_epi8(hits));
+        }
+
+        __attribute__((target("sse2")))
+        const char* findSpecialSSE2(const char* p, const char* end) {
+            while(end - p >= 16) {
+                unsigned mask = specialMask16(p);
+                if(mask) return p + __builtin_ctz(mask);
+                p += 16;
+            }
+            return findSpecialScalar(p, end);
+        }
+
+        __attribute__((target("avx2")))
+        const char* findSpecialAVX2(const char* p, const char* end) {
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i comma = _mm256_set1_epi8(',');
+            const __m256i lf = _mm256_set1_epi8('\n');
+            const __m256i cr = _mm256_set1_epi8('\r');
+
+            // CSV fields are mostly short, so probe the first 16 bytes narrowly
+            if(end - p >= 16) {
+                unsigned mask = specialMask16(p);
+                if(mask) return p + __builtin_ctz(mask);
+                p += 16;
+            }
+
+            // 32 bytes at a time, one mask bit per special character
+            while(end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, comma)),
+                                               _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+                if(mask) return p + __builtin_ctz(mask);
+                p += 32;
+            }
+            return findSpecialSSE2(p, end);
+        }
+#else
+        const char* findSpecialSSE2(const char* p, const char* end) { return findSpecialScalar(p, end); }
+        const char* findSpecialAVX2(const char* p, const char* end) { return findSpecialScalar(p, end); }
+#endif
+
+        typedef const char* (*ScanKernel)(const char*, const char*);
+
+        // Pick the widest kernel the running CPU supports
+        static ScanKernel selectKernel() {
+#ifdef CSV_SCAN_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx2")) return findSpecialAVX2;
+            if(__builtin_cpu_supports("sse2")) return findSpecialSSE2;
+#endif
+            return findSpecialScalar;
+        }
+
+        static const ScanKernel kernel = selectKernel();
+
+        const char* findSpecial(const char* p, const char* end) {
+            return kernel(p, end);
+        }
+
+        const char* scanKernelName() {
+            if(kernel == findSpecialAVX2) return "avx2";
+            if(kernel == findSpecialSSE2) return "sse2";
+            return "scalar";
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef CSV_SCAN_H
+#define CSV_SCAN_H
+
+#include <cstddef>
+
+namespace CSVParser {
+    namespace detail {
+        // Returns the first '"', ',', '\n' or '\r' in [p, end), or end if none.
+        // Uses AVX2 or SSE2 when the CPU supports it, scalar code otherwise.
+        const char* findSpecial(const char* p, const char* end);
+
+        // Individual kernels, compared by bench/csvscan.cpp
+        const char* findSpecialScalar(const char* p, const char* end);
+        const char* findSpecialSSE2(const char* p, const char* end);
+        const char* findSpecialAVX2(const char* p, const char* end);
+
+        // Name of the kernel picked by findSpecial
+        const char* scanKernelName();
+    }
+}
+
+#endif // CSV_SCAN_H
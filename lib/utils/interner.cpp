@@ -0,0 +1,17 @@
+#include "utils/interner.h"
+
+StringInterner::StringInterner(int expectedSize) : strings(expectedSize) {}
+
+const char* StringInterner::intern(std::string_view text) {
+    const char** found = strings.get(text);
+    if(found) return *found;
+
+    const char* copy = arena.copy(text.data(), text.size());
+    strings.insert(std::string_view(copy, text.size()), copy);
+    return copy;
+}
+
+const char* StringInterner::find(std::string_view text) {
+    const char** found = strings.get(text);
+    return found ? *found : nullptr;
+}
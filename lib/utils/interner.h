@@ -0,0 +1,51 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstddef>
+#include <string_view>
+
+#include "dst/flathashmap.h"
+#include "utils/arena.h"
+
+// Table of unique strings.
+// intern() returns one canonical, null-terminated copy per distinct text,
+// kept in an arena for the interner's lifetime, so repeated names are stored
+// once and interned strings compare equal exactly when their pointers do.
+// Use PointerHash to key a map by interned pointers without reading the text.
+class StringInterner
+{
+private:
+    StringArena arena;
+    FlatHashMap<std::string_view, const char *> strings; // views into arena
+
+public:
+    StringInterner(int expectedSize = 16);
+
+    StringInterner(const StringInterner &) = delete;
+    StringInterner &operator=(const StringInterner &) = delete;
+
+    // Canonical copy of text, stored on first use
+    const char *intern(std::string_view text);
+
+    // Canonical copy of text, nullptr if it was never interned. Never allocates
+    const char *find(std::string_view text);
+
+    // Number of distinct strings
+    int size() const { return strings.getSize(); }
+
+    // Bytes of string storage
+    size_t bytes() const { return arena.size(); }
+
+    // Hash policy for maps keyed by interned pointers: hashes the address,
+    // since equal text means equal pointer
+    struct PointerHash
+    {
+        static unsigned int hash(const char *key)
+        {
+            uint64_t address = reinterpret_cast<uintptr_t>(key);
+            return mixHash(static_cast<unsigned int>(address) ^ static_cast<unsigned int>(address >> 32));
+        }
+    };
+};
+
+#endif // INTERNER_H
@@ -0,0 +1,99 @@
+#include "utils/pipeline.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+    // State shared by the workers of one run()
+    struct RunState {
+        std::mutex lock;
+        std::condition_variable finished;
+        unsigned started = 0; // stages taken by a worker
+        unsigned done = 0;    // stages that ran or were skipped
+        unsigned failed = 0;  // stages that threw or were skipped
+        const char* error = nullptr;
+        std::chrono::steady_clock::time_point begin;
+    };
+
+    double secondsSince(std::chrono::steady_clock::time_point begin) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+}
+
+Pipeline::Pipeline() : count(0), total(0) {}
+
+int Pipeline::add(const char* name, Task task, void* context, unsigned after) {
+    if(count == MAX_STAGES) throw "Too many pipeline stages";
+    if(after >> count) throw "Pipeline dependency added after its stage";
+
+    Stage& stage = stages[count];
+    stage.name = name;
+    stage.task = task;
+    stage.context = context;
+    stage.after = after;
+    stage.start = 0;
+    stage.seconds = 0;
+    stage.skipped = false;
+    return count++;
+}
+
+void Pipeline::run(unsigned workers) {
+    RunState state;
+    state.begin = Clock::now();
+
+    if(workers == 0) workers = std::thread::hardware_concurrency();
+    if(workers == 0) workers = 1;
+    if(workers > static_cast<unsigned>(count)) workers = count;
+
+    unsigned all = count == MAX_STAGES ? ~0u : (1u << count) - 1;
+    auto work = [this, all, &state]() {
+        std::unique_lock<std::mutex> guard(state.lock);
+        while(state.started != all) {
+            // Take the first stage, in the order added, whose dependencies are done
+            int next = -1;
+            for(int i = 0; i < count && next < 0; i++) {
+                bool waiting = !(state.started & (1u << i));
+                if(waiting && (state.done & stages[i].after) == stages[i].after) next = i;
+            }
+            if(next < 0) {
+                state.finished.wait(guard);
+                continue;
+            }
+
+            Stage& stage = stages[next];
+            state.started |= 1u << next;
+            bool skip = (state.failed & stage.after) != 0;
+            stage.start = secondsSince(state.begin);
+            guard.unlock();
+
+            // Skip the stage if one of its dependencies failed
+            const char* error = nullptr;
+            if(!skip) {
+                try {
+                    stage.task(stage.context);
+                } catch(const char* e) {
+                    error = e;
+                } catch(...) {
+                    error = "Pipeline stage failed";
+                }
+            }
+
+            guard.lock();
+            stage.skipped = skip;
+            stage.seconds = skip ? 0 : secondsSince(state.begin) - stage.start;
+            if(skip || error) state.failed |= 1u << next;
+            if(error && !state.error) state.error = error;
+            state.done |= 1u << next;
+            state.finished.notify_all();
+        }
+    };
+
+    std::thread threads[MAX_STAGES];
+    for(unsigned i = 1; i < workers; i++) threads[i] = std::thread(work);
+    work();
+    for(unsigned i = 1; i < workers; i++) threads[i].join();
+    total = secondsSince(state.begin);
+
+    if(state.error) throw state.error;
+}
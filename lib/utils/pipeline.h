@@ -0,0 +1,64 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <cstddef>
+#include <chrono>
+
+// Dependency graph of startup stages.
+// A stage becomes ready as soon as every stage it depends on has finished, and
+// ready stages run concurrently on a small pool of workers, so independent work
+// (parsing separate files, building separate indices) overlaps. Stages are
+// timed with a wall clock, which shows the critical path rather than CPU time
+// summed over threads.
+class Pipeline
+{
+public:
+    typedef void (*Task)(void *context);
+
+    static const int MAX_STAGES = 32;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Stage
+    {
+        const char *name;
+        Task task;
+        void *context;
+        unsigned after; // bit i = depends on stage i
+        double start;   // seconds since run() started
+        double seconds; // wall time spent in the stage, 0 if skipped
+        bool skipped;   // a dependency failed, the stage never ran
+    };
+
+    Stage stages[MAX_STAGES];
+    int count;
+    double total;
+
+public:
+    Pipeline();
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    // Add a stage running task(context) once all stages in after (bit i =
+    // stage i) are done. Dependencies must be added first. Returns the stage id
+    int add(const char *name, Task task, void *context, unsigned after = 0);
+
+    // Run every stage on up to workers threads (0 = one per hardware thread,
+    // the calling thread is one of them) and wait for all of them. Ready stages
+    // start in the order added. Stages depending on a failed stage are skipped,
+    // then the first error is rethrown
+    void run(unsigned workers = 0);
+
+    int size() const { return count; }
+    const char *name(int stage) const { return stages[stage].name; }
+    double start(int stage) const { return stages[stage].start; }
+    double seconds(int stage) const { return stages[stage].seconds; }
+    bool skipped(int stage) const { return stages[stage].skipped; }
+
+    // Wall time of the last run()
+    double totalSeconds() const { return total; }
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,483 @@
+#include "utils/snapshot.h"
+
+#include "classes/actor.h"
+#include "classes/movie.h"
+#include "dst/bipartitegraph.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+
+namespace Snapshot {
+    namespace {
+        const char MAGIC[8] = {'M', 'O', 'V', 'S', 'N', 'A', 'P', '\0'};
+        const int MAX_SOURCES = 8;
+
+        enum Section {
+            ACTORS,              // ActorRecord[actor_count]
+            MOVIES,              // MovieRecord[movie_count]
+            ACTOR_EDGE_OFFSETS,  // uint64_t[actor_count + 1] into ACTOR_EDGES
+            ACTOR_EDGES,         // int32_t movie table indices, ascending per actor
+            MOVIE_EDGE_OFFSETS,  // uint64_t[movie_count + 1] into MOVIE_EDGES
+            MOVIE_EDGES,         // int32_t actor table indices, ascending per movie
+            ACTOR_NAME_KEYS,     // uint64_t string offsets, sorted by name
+            ACTOR_NAME_INDICES,  // int32_t actor table indices
+            ACTOR_YEAR_KEYS,     // int32_t, sorted by year
+            ACTOR_YEAR_INDICES,  // int32_t actor table indices
+            MOVIE_TITLE_KEYS,    // uint64_t string offsets, sorted by title
+            MOVIE_TITLE_INDICES, // int32_t movie table indices
+            MOVIE_YEAR_KEYS,     // int32_t, sorted by year
+            MOVIE_YEAR_INDICES,  // int32_t movie table indices
+            STRINGS,             // null-terminated strings
+            SECTION_COUNT
+        };
+
+        struct SourceStamp {
+            uint64_t size;
+            int64_t mtime;
+        };
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t sourceCount;
+            SourceStamp sources[MAX_SOURCES];
+            uint64_t actorCount;
+            uint64_t movieCount;
+            uint64_t sections[SECTION_COUNT];
+            uint64_t fileSize;
+        };
+
+        const uint32_t PLOT_IN_STRINGS = 1; // plot stored in STRINGS, not the CSV
+        const uint32_t PLOT_QUOTED = 2;
+
+        struct ActorRecord {
+            int32_t id;
+            int32_t year;
+            uint64_t name;
+        };
+
+        struct MovieRecord {
+            int32_t id;
+            int32_t year;
+            uint64_t title;
+            uint64_t plot;       // STRINGS offset or byte offset in the movie CSV
+            uint32_t plotLength; // raw CSV field length
+            uint32_t plotFlags;
+        };
+
+        bool stampFile(const char* filename, SourceStamp& stamp) {
+            struct stat st;
+            if(stat(filename, &st) != 0) return false;
+            stamp.size = static_cast<uint64_t>(st.st_size);
+            stamp.mtime = static_cast<int64_t>(st.st_mtime);
+            return true;
+        }
+
+        // Sequential writer that tracks offsets and pads sections to 8 bytes
+        struct Writer {
+            FILE* file;
+            uint64_t offset;
+
+            void write(const void* data, size_t bytes) {
+                if(bytes && fwrite(data, 1, bytes, file) != bytes) throw "Snapshot write failed";
+                offset += bytes;
+            }
+
+            uint64_t beginSection() {
+                static const char zeros[8] = {0};
+                write(zeros, (8 - offset % 8) % 8);
+                return offset;
+            }
+        };
+
+        // String table built while writing, offsets are relative to STRINGS
+        struct StringTable {
+            char* data;
+            uint64_t size;
+            uint64_t capacity;
+
+            uint64_t add(const char* s) {
+                size_t length = strlen(s) + 1;
+                if(size + length > capacity) {
+                    capacity = (capacity ? capacity * 2 : 1 << 16) + length;
+                    data = static_cast<char*>(realloc(data, capacity));
+                }
+                memcpy(data + size, s, length);
+                size += length;
+                return size - length;
+            }
+        };
+
+        // Table string pointer and its offset, to share strings with index keys
+        struct StringRef {
+            const char* pointer;
+            uint64_t offset;
+        };
+
+        int compareRefs(const void* a, const void* b) {
+            const char* pa = static_cast<const StringRef*>(a)->pointer;
+            const char* pb = static_cast<const StringRef*>(b)->pointer;
+            return pa < pb ? -1 : (pa > pb ? 1 : 0);
+        }
+
+        // Write index keys as offsets of strings already in the table
+        void writeKeys(Writer& out, StringTable& strings, const char** keys, size_t count,
+                       StringRef* refs, size_t refCount) {
+            qsort(refs, refCount, sizeof(StringRef), compareRefs);
+            for(size_t i = 0; i < count; i++) {
+                StringRef key = StringRef{keys[i], 0};
+                const StringRef* found = static_cast<const StringRef*>(
+                    bsearch(&key, refs, refCount, sizeof(StringRef), compareRefs));
+                uint64_t offset = found ? found->offset : strings.add(keys[i]);
+                out.write(&offset, sizeof(offset));
+            }
+        }
+
+        // Write one side of the cast graph as running edge offsets, count + 1 entries
+        void writeOffsets(Writer& out, const BipartiteGraph& graph, BipartiteGraph::Side side, size_t count) {
+            uint64_t edges = 0;
+            out.write(&edges, sizeof(edges));
+            for(size_t i = 0; i < count; i++) {
+                edges += graph.neighbours(side, i).size();
+                out.write(&edges, sizeof(edges));
+            }
+        }
+
+        void writeNeighbours(Writer& out, const BipartiteGraph& graph, BipartiteGraph::Side side, size_t count) {
+            for(size_t i = 0; i < count; i++) {
+                BipartiteGraph::Range range = graph.neighbours(side, i);
+                out.write(range.begin(), range.size() * sizeof(int32_t));
+            }
+        }
+
+        template<typename T>
+        T* section(const CSVParser::Source* file, const Header* header, Section s) {
+            return reinterpret_cast<T*>(const_cast<char*>(file->data()) + header->sections[s]);
+        }
+
+        // Bytes from the start of section s to the next section or the end of the file
+        uint64_t sectionBytes(const Header* header, int s) {
+            uint64_t end = s + 1 < SECTION_COUNT ? header->sections[s + 1] : header->fileSize;
+            return end - header->sections[s];
+        }
+
+        // Section s holds at least count entries of the given size
+        bool fits(const Header* header, Section s, uint64_t count, size_t size) {
+            return count <= sectionBytes(header, s) / size;
+        }
+
+        // Offsets start at 0, never decrease and end at the number of edges,
+        // which fill the edge section up to its padding. Each row holds
+        // indices below otherCount in ascending order, repeated edges side
+        // by side
+        bool validEdges(const uint64_t* offsets, uint64_t count, const int32_t* edges, uint64_t edgeBytes,
+                        uint64_t otherCount) {
+            if(offsets[0] != 0) return false;
+            for(uint64_t i = 0; i < count; i++) {
+                if(offsets[i + 1] < offsets[i]) return false;
+            }
+
+            uint64_t total = offsets[count];
+            if(total > edgeBytes / sizeof(int32_t) || edgeBytes - total * sizeof(int32_t) >= 8) return false;
+
+            for(uint64_t i = 0; i < count; i++) {
+                for(uint64_t e = offsets[i]; e < offsets[i + 1]; e++) {
+                    if(edges[e] < 0 || static_cast<uint64_t>(edges[e]) >= otherCount) return false;
+                    if(e > offsets[i] && edges[e - 1] > edges[e]) return false;
+                }
+            }
+            return true;
+        }
+
+        // Every entry is below limit
+        bool validIndices(const int32_t* indices, uint64_t count, uint64_t limit) {
+            for(uint64_t i = 0; i < count; i++) {
+                if(indices[i] < 0 || static_cast<uint64_t>(indices[i]) >= limit) return false;
+            }
+            return true;
+        }
+
+        // Every offset starts a string inside STRINGS. The section ends with a
+        // terminator, so each of those strings ends inside it too
+        bool validStrings(const uint64_t* offsets, uint64_t count, uint64_t stringBytes) {
+            for(uint64_t i = 0; i < count; i++) {
+                if(offsets[i] >= stringBytes) return false;
+            }
+            return true;
+        }
+
+        // Check that the counts fit their sections and that every offset
+        // stored in them stays inside the file, so Load never reads past the
+        // mapping. The header itself has already been checked
+        bool validSections(const CSVParser::Source* file, const Header* header) {
+            uint64_t actorCount = header->actorCount;
+            uint64_t movieCount = header->movieCount;
+
+            // Table indices are ints
+            if(actorCount > INT32_MAX || movieCount > INT32_MAX) return false;
+
+            bool sized = fits(header, ACTORS, actorCount, sizeof(ActorRecord)) &&
+                         fits(header, MOVIES, movieCount, sizeof(MovieRecord)) &&
+                         fits(header, ACTOR_EDGE_OFFSETS, actorCount + 1, sizeof(uint64_t)) &&
+                         fits(header, MOVIE_EDGE_OFFSETS, movieCount + 1, sizeof(uint64_t)) &&
+                         fits(header, ACTOR_NAME_KEYS, actorCount, sizeof(uint64_t)) &&
+                         fits(header, ACTOR_NAME_INDICES, actorCount, sizeof(int32_t)) &&
+                         fits(header, ACTOR_YEAR_KEYS, actorCount, sizeof(int32_t)) &&
+                         fits(header, ACTOR_YEAR_INDICES, actorCount, sizeof(int32_t)) &&
+                         fits(header, MOVIE_TITLE_KEYS, movieCount, sizeof(uint64_t)) &&
+                         fits(header, MOVIE_TITLE_INDICES, movieCount, sizeof(int32_t)) &&
+                         fits(header, MOVIE_YEAR_KEYS, movieCount, sizeof(int32_t)) &&
+                         fits(header, MOVIE_YEAR_INDICES, movieCount, sizeof(int32_t));
+            if(!sized) return false;
+
+            if(!validEdges(section<const uint64_t>(file, header, ACTOR_EDGE_OFFSETS), actorCount,
+                           section<const int32_t>(file, header, ACTOR_EDGES), sectionBytes(header, ACTOR_EDGES), movieCount) ||
+               !validEdges(section<const uint64_t>(file, header, MOVIE_EDGE_OFFSETS), movieCount,
+                           section<const int32_t>(file, header, MOVIE_EDGES), sectionBytes(header, MOVIE_EDGES), actorCount)) {
+                return false;
+            }
+
+            uint64_t stringBytes = sectionBytes(header, STRINGS);
+            if(stringBytes == 0 || file->data()[header->fileSize - 1] != '\0') return false;
+
+            const ActorRecord* actorRecords = section<const ActorRecord>(file, header, ACTORS);
+            for(uint64_t i = 0; i < actorCount; i++) {
+                if(actorRecords[i].name >= stringBytes) return false;
+            }
+            const MovieRecord* movieRecords = section<const MovieRecord>(file, header, MOVIES);
+            for(uint64_t i = 0; i < movieCount; i++) {
+                if(movieRecords[i].title >= stringBytes) return false;
+                if((movieRecords[i].plotFlags & PLOT_IN_STRINGS) && movieRecords[i].plot >= stringBytes) return false;
+            }
+
+            return validStrings(section<const uint64_t>(file, header, ACTOR_NAME_KEYS), actorCount, stringBytes) &&
+                   validStrings(section<const uint64_t>(file, header, MOVIE_TITLE_KEYS), movieCount, stringBytes) &&
+                   validIndices(section<const int32_t>(file, header, ACTOR_NAME_INDICES), actorCount, actorCount) &&
+                   validIndices(section<const int32_t>(file, header, ACTOR_YEAR_INDICES), actorCount, actorCount) &&
+                   validIndices(section<const int32_t>(file, header, MOVIE_TITLE_INDICES), movieCount, movieCount) &&
+                   validIndices(section<const int32_t>(file, header, MOVIE_YEAR_INDICES), movieCount, movieCount);
+        }
+    }
+
+    void Write(const char* path, const Data& data, const char* const* sources, int sourceCount) {
+        if(sourceCount > MAX_SOURCES) throw "Too many snapshot sources";
+
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.sourceCount = static_cast<uint32_t>(sourceCount);
+        for(int i = 0; i < sourceCount; i++) {
+            if(!stampFile(sources[i], header.sources[i])) throw "Snapshot source missing";
+        }
+        header.actorCount = data.actor_count;
+        header.movieCount = data.movie_count;
+
+        // Write to a temporary file and rename, so readers never see half a snapshot
+        size_t pathLength = strlen(path);
+        char* tempPath = new char[pathLength + 5];
+        memcpy(tempPath, path, pathLength);
+        memcpy(tempPath + pathLength, ".tmp", 5);
+
+        Writer out = Writer{fopen(tempPath, "wb"), 0};
+        if(!out.file) {
+            delete[] tempPath;
+            throw "Snapshot open failed";
+        }
+
+        StringTable strings = StringTable{nullptr, 0, 0};
+        StringRef* actorRefs = new StringRef[data.actor_count];
+        StringRef* movieRefs = new StringRef[data.movie_count];
+
+        try {
+            // Header is rewritten once every section offset is known
+            out.write(&header, sizeof(header));
+
+            header.sections[ACTORS] = out.beginSection();
+            for(size_t i = 0; i < data.actor_count; i++) {
+                const Actor& actor = data.actors[i];
+                ActorRecord record = ActorRecord{actor.id, actor.year, strings.add(actor.name)};
+                actorRefs[i] = StringRef{actor.name, record.name};
+                out.write(&record, sizeof(record));
+            }
+
+            header.sections[MOVIES] = out.beginSection();
+            for(size_t i = 0; i < data.movie_count; i++) {
+                const Movie& movie = data.movies[i];
+                MovieRecord record = MovieRecord{movie.id, movie.year, strings.add(movie.title), 0, 0, 0};
+                movieRefs[i] = StringRef{movie.title, record.title};
+
+                // Unfetched lazy plots keep pointing into the movie CSV
+                if(movie.plot.value) {
+                    record.plot = strings.add(movie.plot.value);
+                    record.plotFlags = PLOT_IN_STRINGS;
+                }
+                else {
+                    record.plot = movie.plot.offset;
+                    record.plotLength = movie.plot.length;
+                    record.plotFlags = movie.plot.quoted ? PLOT_QUOTED : 0;
+                }
+                out.write(&record, sizeof(record));
+            }
+
+            // Cast graph as offset + neighbour arrays, edits folded in
+            header.sections[ACTOR_EDGE_OFFSETS] = out.beginSection();
+            writeOffsets(out, *data.cast, BipartiteGraph::LEFT, data.actor_count);
+            header.sections[ACTOR_EDGES] = out.beginSection();
+            writeNeighbours(out, *data.cast, BipartiteGraph::LEFT, data.actor_count);
+            header.sections[MOVIE_EDGE_OFFSETS] = out.beginSection();
+            writeOffsets(out, *data.cast, BipartiteGraph::RIGHT, data.movie_count);
+            header.sections[MOVIE_EDGES] = out.beginSection();
+            writeNeighbours(out, *data.cast, BipartiteGraph::RIGHT, data.movie_count);
+
+            // Index arrays, name keys share the table's strings
+            header.sections[ACTOR_NAME_KEYS] = out.beginSection();
+            writeKeys(out, strings, data.actor_names, data.actor_count, actorRefs, data.actor_count);
+            header.sections[ACTOR_NAME_INDICES] = out.beginSection();
+            out.write(data.actor_name_indices, data.actor_count * sizeof(int));
+            header.sections[ACTOR_YEAR_KEYS] = out.beginSection();
+            out.write(data.actor_years, data.actor_count * sizeof(int));
+            header.sections[ACTOR_YEAR_INDICES] = out.beginSection();
+            out.write(data.actor_year_indices, data.actor_count * sizeof(int));
+
+            header.sections[MOVIE_TITLE_KEYS] = out.beginSection();
+            writeKeys(out, strings, data.movie_titles, data.movie_count, movieRefs, data.movie_count);
+            header.sections[MOVIE_TITLE_INDICES] = out.beginSection();
+            out.write(data.movie_title_indices, data.movie_count * sizeof(int));
+            header.sections[MOVIE_YEAR_KEYS] = out.beginSection();
+            out.write(data.movie_years, data.movie_count * sizeof(int));
+            header.sections[MOVIE_YEAR_INDICES] = out.beginSection();
+            out.write(data.movie_year_indices, data.movie_count * sizeof(int));
+
+            header.sections[STRINGS] = out.beginSection();
+            out.write(strings.data, strings.size);
+            header.fileSize = out.offset;
+
+            // Patch the header now that the layout is known
+            if(fseek(out.file, 0, SEEK_SET) != 0) throw "Snapshot write failed";
+            out.write(&header, sizeof(header));
+        }
+        catch(...) {
+            fclose(out.file);
+            remove(tempPath);
+            free(strings.data);
+            delete[] actorRefs;
+            delete[] movieRefs;
+            delete[] tempPath;
+            throw;
+        }
+
+        free(strings.data);
+        delete[] actorRefs;
+        delete[] movieRefs;
+        bool ok = fclose(out.file) == 0 && rename(tempPath, path) == 0;
+        if(!ok) remove(tempPath);
+        delete[] tempPath;
+        if(!ok) throw "Snapshot write failed";
+    }
+
+    bool Load(const char* path, Data& data, const char* const* sources, int sourceCount) {
+        struct stat st;
+        if(stat(path, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) return false;
+
+        CSVParser::Source* file = new CSVParser::Source();
+        try {
+            file->open(path);
+        }
+        catch(const char*) {
+            delete file;
+            return false;
+        }
+
+        // Validate the header before trusting any offset in it
+        const Header* header = reinterpret_cast<const Header*>(file->data());
+        bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                     header->version == VERSION &&
+                     header->fileSize == file->size() &&
+                     sourceCount <= MAX_SOURCES &&
+                     header->sourceCount == static_cast<uint32_t>(sourceCount);
+        for(int i = 0; valid && i < SECTION_COUNT; i++) {
+            valid = header->sections[i] % 8 == 0 && header->sections[i] <= file->size() &&
+                    (i == 0 || header->sections[i - 1] <= header->sections[i]);
+        }
+
+        // Rebuild whenever a source CSV's size or mtime changed
+        for(int i = 0; valid && i < sourceCount; i++) {
+            SourceStamp stamp;
+            valid = stampFile(sources[i], stamp) &&
+                    stamp.size == header->sources[i].size &&
+                    stamp.mtime == header->sources[i].mtime;
+        }
+
+        valid = valid && validSections(file, header);
+
+        if(!valid) {
+            delete file;
+            return false;
+        }
+
+        size_t actorCount = header->actorCount;
+        size_t movieCount = header->movieCount;
+        const char* strings = file->data() + header->sections[STRINGS];
+
+        const ActorRecord* actorRecords = section<const ActorRecord>(file, header, ACTORS);
+        const MovieRecord* movieRecords = section<const MovieRecord>(file, header, MOVIES);
+        const uint64_t* actorEdgeOffsets = section<const uint64_t>(file, header, ACTOR_EDGE_OFFSETS);
+        const int32_t* actorEdges = section<const int32_t>(file, header, ACTOR_EDGES);
+        const uint64_t* movieEdgeOffsets = section<const uint64_t>(file, header, MOVIE_EDGE_OFFSETS);
+        const int32_t* movieEdges = section<const int32_t>(file, header, MOVIE_EDGES);
+
+        // Tables, with strings pointing straight into the mapping
+        data.actors = static_cast<Actor*>(malloc(actorCount * sizeof(Actor)));
+        for(size_t i = 0; i < actorCount; i++) {
+            Actor& actor = data.actors[i];
+            actor.id = actorRecords[i].id;
+            actor.year = actorRecords[i].year;
+            actor.name = const_cast<char*>(strings + actorRecords[i].name);
+        }
+
+        data.movies = static_cast<Movie*>(malloc(movieCount * sizeof(Movie)));
+        for(size_t i = 0; i < movieCount; i++) {
+            Movie& movie = data.movies[i];
+            const MovieRecord& record = movieRecords[i];
+            movie.id = record.id;
+            movie.year = record.year;
+            movie.title = const_cast<char*>(strings + record.title);
+            movie.plot = CSVParser::LazyString();
+            if(record.plotFlags & PLOT_IN_STRINGS) {
+                movie.plot.value = const_cast<char*>(strings + record.plot);
+            }
+            else {
+                movie.plot.offset = record.plot;
+                movie.plot.length = record.plotLength;
+                movie.plot.quoted = record.plotFlags & PLOT_QUOTED;
+            }
+        }
+
+        // The cast graph reads its CSR arrays straight from the mapping
+        data.cast->adopt(actorCount, actorEdgeOffsets, actorEdges, movieCount, movieEdgeOffsets, movieEdges);
+
+        // Index arrays are used in place, only string keys need resolving
+        const uint64_t* actorNameKeys = section<const uint64_t>(file, header, ACTOR_NAME_KEYS);
+        data.actor_names = new const char*[actorCount];
+        for(size_t i = 0; i < actorCount; i++) data.actor_names[i] = strings + actorNameKeys[i];
+        data.actor_name_indices = section<int>(file, header, ACTOR_NAME_INDICES);
+        data.actor_years = section<int>(file, header, ACTOR_YEAR_KEYS);
+        data.actor_year_indices = section<int>(file, header, ACTOR_YEAR_INDICES);
+
+        const uint64_t* movieTitleKeys = section<const uint64_t>(file, header, MOVIE_TITLE_KEYS);
+        data.movie_titles = new const char*[movieCount];
+        for(size_t i = 0; i < movieCount; i++) data.movie_titles[i] = strings + movieTitleKeys[i];
+        data.movie_title_indices = section<int>(file, header, MOVIE_TITLE_INDICES);
+        data.movie_years = section<int>(file, header, MOVIE_YEAR_KEYS);
+        data.movie_year_indices = section<int>(file, header, MOVIE_YEAR_INDICES);
+
+        data.actor_count = actorCount;
+        data.movie_count = movieCount;
+        data.file = file;
+        return true;
+    }
+}
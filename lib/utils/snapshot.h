@@ -0,0 +1,60 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/csvparser.h"
+
+struct Actor;
+struct Movie;
+class BipartiteGraph;
+
+// Binary snapshot of the loaded dataset, so a warm start can map one file
+// instead of re-parsing the CSVs, re-sorting and rebuilding the cast graph.
+//
+// Layout: a fixed header followed by 8-byte aligned sections. Sections refer
+// to each other by byte offset, never by pointer, so the file is usable
+// straight from a read-only mapping.
+namespace Snapshot {
+    const uint32_t VERSION = 3;
+
+    // Tables and sorted index arrays held by a snapshot
+    struct Data {
+        Actor* actors;
+        size_t actor_count;
+        Movie* movies;
+        size_t movie_count;
+
+        // Cast graph, actors on the left and movies on the right
+        BipartiteGraph* cast;
+
+        // Sorted keys with matching table indices, as passed to BPlusTree::bulk_load
+        const char** actor_names;
+        int* actor_name_indices;
+        int* actor_years;
+        int* actor_year_indices;
+        const char** movie_titles;
+        int* movie_title_indices;
+        int* movie_years;
+        int* movie_year_indices;
+
+        // Mapping that loaded strings and index arrays point into
+        CSVParser::Source* file;
+    };
+
+    // Write the tables, the cast graph's CSR arrays and the index arrays, all
+    // by table index. sources are the CSV files the data
+    // was parsed from; their size and mtime are recorded so stale snapshots
+    // can be detected.
+    void Write(const char* path, const Data& data, const char* const* sources, int sourceCount);
+
+    // Map a snapshot and fill data. Returns false if the file is missing,
+    // malformed, from another version, or any source changed since it was
+    // written. The actor and movie tables are malloc'd, actor_names and
+    // movie_titles are new[]'d, everything else points into data.file.
+    // data.cast must be set by the caller; it adopts the mapped edge arrays.
+    bool Load(const char* path, Data& data, const char* const* sources, int sourceCount);
+}
+
+#endif // SNAPSHOT_H
@@ -1,11 +1,14 @@
 #include <iostream>
 #include <string>
+#include <cstring>
 #include <ctime>
+#include <chrono>
 
 #include "algs/quicksort.h"
 
 #include "dst/bplustree.h"
-#include "dst/hashmap.h"
+#include "dst/frozenhashmap.h"
+#include "dst/bipartitegraph.h"
 #include "dst/avl.h"
 
 #include "classes/actor.h"
@@ -13,32 +16,84 @@
 #include "classes/actor-movie.h"
 
 #include "utils/debug.h"
+#include "utils/pipeline.h"
+#include "utils/snapshot.h"
+
+// Data files
+#ifdef LARGE
+const char *ACTORS_CSV = "data/actors-large.csv";
+const char *MOVIES_CSV = "data/movies-large.csv";
+const char *CAST_CSV = "data/cast-large.csv";
+const char *DEFAULT_SNAPSHOT = "data/large.snapshot";
+#else
+const char *ACTORS_CSV = "data/actors-demo.csv";
+const char *MOVIES_CSV = "data/movies-demo.csv";
+const char *CAST_CSV = "data/cast-demo.csv";
+const char *DEFAULT_SNAPSHOT = "data/demo.snapshot";
+#endif // LARGE
 
 // Global variables
+// Actors and movies live in dense tables; the cast graph, index trees and
+// queries all use table indices. CSV ids are only translated on load and
+// when the admin panel assigns a new one
 size_t actor_count, movie_count, actor_movie_count;
+size_t actor_capacity, movie_capacity;
 Actor *actors;
 Movie *movies;
-ActorMovie *actor_movies_csv;
+StringArena *string_arena;
+CSVParser::Source *movie_source;
 
-HashMap<int, Actor> *actor_map;
-HashMap<int, Movie> *movie_map;
+// CSV id -> table index. Frozen after load, admin edits go to the overlay
+FrozenHashMap<int, int> *actor_id_map;
+FrozenHashMap<int, int> *movie_id_map;
+
+// Cast relations: actors on the left, movies on the right
+BipartiteGraph *cast_graph;
 
 BPlusTree<const char *, int> *actor_name_index;
 BPlusTree<const char *, int> *movie_name_index;
 BPlusTree<int, int> *actor_year_index;
 BPlusTree<int, int> *movie_year_index;
 
+// Sorted index arrays, kept after bulk loading only when a snapshot is written
+Snapshot::Data snapshot_data;
+bool keep_index_arrays = false;
+
+// State shared by the startup pipeline stages
+struct StartupContext
+{
+    CSVParser::Options actor_options;
+    CSVParser::Options movie_options;
+    CSVParser::Options cast_options;
+};
+
 // Function prototypes
-void populate_main_hashmap();
-void populate_actor_indices();
+void load_csv_files(bool keep_arrays);
+void parse_actors(void *context);
+void parse_movies(void *context);
+void parse_cast(void *context);
+void add_cast_relations(const ActorMovie *rows, size_t count, void *context);
+void populate_actor_id_map(void *context);
+void populate_movie_id_map(void *context);
+template <typename T>
+FrozenHashMap<int, int> *freeze_id_map(const T *table, size_t count);
+int append_actor(const Actor &actor);
+int append_movie(const Movie &movie);
 void populate_actor_name_index();
 void populate_actor_year_index();
 void populate_movie_name_index();
 void populate_movie_year_index();
-void populate_movie_indices();
-void populate_relation_hashmaps();
-
-AVLTree<std::string> *get_actor_relations(int actor_id, int depth, const std::string &original_name);
+Actor *copy_actors_for_sort();
+Movie *copy_movies_for_sort();
+void create_index_trees();
+double seconds_since(std::chrono::steady_clock::time_point start);
+#ifdef DEBUG
+void print_hash_stats(const char *name, const HashStats &stats);
+#endif
+bool load_snapshot(const char *path);
+void write_snapshot(const char *path);
+
+AVLTree<std::string> *get_actor_relations(int actor_index, int depth, const std::string &original_name);
 
 int get_year();
 
@@ -50,69 +105,51 @@ void display_recent_movies();
 void display_actor_movies();
 void display_movie_actors();
 void display_actor_relations();
+void display_common_movies();
 void display_add_new_actor();
 void display_add_new_movie();
 void display_add_actor_to_movie();
 void display_update_actor_details();
 void display_update_movie_details();
 
-int main()
+int main(int argc, char *argv[])
 {
     // Variables
     bool admin = false;
-    clock_t original_start = clock();
-    clock_t start = clock();
+    auto original_start = std::chrono::steady_clock::now();
+    auto start = original_start;
 
-// Load data from CSV files
-#ifdef LARGE
-    actors = CSVParser::Parse<Actor>("data/actors-large.csv", &actor_count);
-#else
-    actors = CSVParser::Parse<Actor>("data/actors-demo.csv", &actor_count);
-#endif // LARGE
-    DEBUG_PRINTF("Loaded %zu actors in %.2f seconds\n", actor_count,
-                 (double)(clock() - start) / CLOCKS_PER_SEC);
-
-    start = clock();
-#ifdef LARGE
-    movies = CSVParser::Parse<Movie>("data/movies-large.csv", &movie_count);
-#else
-    movies = CSVParser::Parse<Movie>("data/movies-demo.csv", &movie_count);
-#endif // LARGE
-    DEBUG_PRINTF("Loaded %zu movies in %.2f seconds\n", movie_count,
-                 (double)(clock() - start) / CLOCKS_PER_SEC);
-
-    start = clock();
-#ifdef LARGE
-    actor_movies_csv = CSVParser::Parse<ActorMovie>("data/cast-large.csv", &actor_movie_count);
-#else
-    actor_movies_csv = CSVParser::Parse<ActorMovie>("data/cast-demo.csv", &actor_movie_count);
-#endif // LARGE
-    DEBUG_PRINTF("Loaded %zu cast relations in %.2f seconds\n", actor_movie_count,
-                 (double)(clock() - start) / CLOCKS_PER_SEC);
-
-    // Initialise main hashmap, index trees & relation hashmaps
-    actor_map = new HashMap<int, Actor>(actor_count);
-    movie_map = new HashMap<int, Movie>(movie_count);
+    // Optional binary snapshot: --snapshot [path]
+    const char *snapshot_path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--snapshot") == 0)
+        {
+            snapshot_path = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : DEFAULT_SNAPSHOT;
+        }
+    }
 
-    actor_name_index = new BPlusTree<const char *, int>();
-    movie_name_index = new BPlusTree<const char *, int>();
+    string_arena = new StringArena();
+    movie_source = new CSVParser::Source();
+    cast_graph = new BipartiteGraph();
 
-    actor_year_index = new BPlusTree<int, int>();
-    movie_year_index = new BPlusTree<int, int>();
-
-    // Populate main hashmap, index trees & relation hashmaps
-    start = clock();
-    populate_main_hashmap();
-    DEBUG_PRINTF("Populated hashmaps in %.2f seconds\n",
-                 (double)(clock() - start) / CLOCKS_PER_SEC);
+    if (snapshot_path && load_snapshot(snapshot_path))
+    {
+        DEBUG_PRINTF("Loaded snapshot %s in %.2f seconds\n", snapshot_path, seconds_since(start));
+    }
+    else
+    {
+        load_csv_files(snapshot_path != nullptr);
 
-    start = clock();
-    populate_actor_indices();
-    populate_movie_indices();
-    DEBUG_PRINTF("Populated index trees in %.2f seconds\n",
-                 (double)(clock() - start) / CLOCKS_PER_SEC);
+        if (snapshot_path)
+        {
+            start = std::chrono::steady_clock::now();
+            write_snapshot(snapshot_path);
+            DEBUG_PRINTF("Wrote snapshot %s in %.2f seconds\n", snapshot_path, seconds_since(start));
+        }
+    }
 
-    DEBUG_PRINTF("Total time taken: %.2f seconds\n", (double)(clock() - original_start) / CLOCKS_PER_SEC);
+    DEBUG_PRINTF("Total time taken: %.2f seconds\n", seconds_since(original_start));
 
     // Main user interface loop
     int input = 0;
@@ -141,26 +178,27 @@ int main()
         std::cout << "3. Display all movies an actor starred in" << std::endl;
         std::cout << "4. Display all actors in a movie" << std::endl;
         std::cout << "5. Display all actors that an actor knows" << std::endl;
+        std::cout << "6. Display common movies of two actors" << std::endl;
         std::cout << std::endl;
 
         if (admin)
         {
             std::cout << "========== Admin Commands ==========" << std::endl;
-            std::cout << "6. Add a new actor" << std::endl;
-            std::cout << "7. Add a new movie" << std::endl;
-            std::cout << "8. Add a new actor to a movie" << std::endl;
-            std::cout << "9. Update actor details" << std::endl;
-            std::cout << "10. Update movie details" << std::endl;
+            std::cout << "7. Add a new actor" << std::endl;
+            std::cout << "8. Add a new movie" << std::endl;
+            std::cout << "9. Add a new actor to a movie" << std::endl;
+            std::cout << "10. Update actor details" << std::endl;
+            std::cout << "11. Update movie details" << std::endl;
         }
 
         std::cout << "\nChoice (Enter '0' to quit): ";
         std::cin >> input;
 
-        if (input >= 6 && input <= 10 && admin)
+        if (input >= 7 && input <= 11 && admin)
         {
             admin_handler(input);
         }
-        else if (input >= 1 && input <= 5)
+        else if (input >= 1 && input <= 6)
         {
             user_handler(input);
         }
@@ -202,6 +240,9 @@ void user_handler(int input)
     case 5:
         display_actor_relations();
         break;
+    case 6:
+        display_common_movies();
+        break;
     default:
         break;
     }
@@ -216,19 +257,19 @@ void admin_handler(int input)
     switch (input)
     {
 
-    case 6:
+    case 7:
         display_add_new_actor();
         break;
-    case 7:
+    case 8:
         display_add_new_movie();
         break;
-    case 8:
+    case 9:
         display_add_actor_to_movie();
         break;
-    case 9:
+    case 10:
         display_update_actor_details();
         break;
-    case 10:
+    case 11:
         display_update_movie_details();
         break;
     }
@@ -253,7 +294,7 @@ void display_actor_age_range()
     int i = 1;
     while (it.has_next())
     {
-        Actor *actor = actor_map->get(*it.next());
+        Actor *actor = &actors[*it.next()];
         std::cout << i << ". " << actor->name << " (" << actor->year << ")" << std::endl;
         i++;
     }
@@ -275,7 +316,7 @@ void display_recent_movies()
     int i = 1;
     while (it.has_next())
     {
-        Movie *movie = movie_map->get(*it.next());
+        Movie *movie = &movies[*it.next()];
         std::cout << i << ". " << movie->title << " (" << movie->year << ")" << std::endl;
         i++;
     }
@@ -289,25 +330,17 @@ void display_actor_movies()
     std::getline(std::cin, name);
 
     const char *name_data = name.c_str();
-    int *actor_id = actor_name_index->search(name_data);
-    if (actor_id == nullptr)
+    int *actor_index = actor_name_index->search(name_data);
+    if (actor_index == nullptr)
     {
         std::cout << "Actor not found." << std::endl;
         return;
     }
 
-    Actor *actor = actor_map->get(*actor_id);
-    LinkedList<int> *movie_ids = actor->movies;
-    if (movie_ids == nullptr)
-    {
-        std::cout << "Actor has no movies." << std::endl;
-        return;
-    }
-
     AVLTree<std::string> *movie_names = new AVLTree<std::string>();
-    for (auto it = movie_ids->begin(); it != movie_ids->end(); ++it)
+    for (int movie_index : cast_graph->left(*actor_index))
     {
-        Movie *movie = movie_map->get(*it);
+        Movie *movie = &movies[movie_index];
         std::string movie_name = movie->title;
         movie_name += " (" + std::to_string(movie->year) + ")";
         movie_names->insertNode(movie_name);
@@ -330,25 +363,17 @@ void display_movie_actors()
     std::getline(std::cin, title);
 
     const char *title_data = title.c_str();
-    int *movie_id = movie_name_index->search(title_data);
-    if (movie_id == nullptr)
+    int *movie_index = movie_name_index->search(title_data);
+    if (movie_index == nullptr)
     {
         std::cout << "Movie not found." << std::endl;
         return;
     }
 
-    Movie *movie = movie_map->get(*movie_id);
-    LinkedList<int> *actor_ids = movie->actors;
-    if (actor_ids == nullptr)
-    {
-        std::cout << "Movie has no actors." << std::endl;
-        return;
-    }
-
     AVLTree<std::string> *actor_names = new AVLTree<std::string>();
-    for (auto it = actor_ids->begin(); it != actor_ids->end(); ++it)
+    for (int actor_index : cast_graph->right(*movie_index))
     {
-        Actor *actor = actor_map->get(*it);
+        Actor *actor = &actors[actor_index];
         std::string actor_name = actor->name;
         actor_name += " (" + std::to_string(actor->year) + ")";
         actor_names->insertNode(actor_name);
@@ -371,17 +396,16 @@ void display_actor_relations()
     std::getline(std::cin, actor_name);
 
     const char *actor_name_data = actor_name.c_str();
-    int *actor_id = actor_name_index->search(actor_name_data);
+    int *actor_index = actor_name_index->search(actor_name_data);
 
-    if (actor_id == nullptr)
+    if (actor_index == nullptr)
     {
         std::cout << "Actor not found." << std::endl;
         return;
     }
 
-    Actor *actor = actor_map->get(*actor_id);
-    LinkedList<int> *actor_movies = actor->movies;
-    if (actor_movies == nullptr)
+    Actor *actor = &actors[*actor_index];
+    if (cast_graph->left(*actor_index).empty())
     {
         std::cout << "Actor has no movies." << std::endl;
         return;
@@ -389,7 +413,7 @@ void display_actor_relations()
 
     std::string formatted_actor_name = actor_name;
     formatted_actor_name += " (" + std::to_string(actor->year) + ")";
-    AVLTree<std::string> *actor_names = get_actor_relations(*actor_id, 2, formatted_actor_name);
+    AVLTree<std::string> *actor_names = get_actor_relations(*actor_index, 2, formatted_actor_name);
 
     std::cout << "Actors who have worked with " << actor_name << ":" << std::endl;
     int i = 1;
@@ -400,6 +424,55 @@ void display_actor_relations()
     }
 }
 
+void display_common_movies()
+{
+    std::string first_name, second_name;
+    std::cout << "Enter first actor name: ";
+    std::cin.ignore();
+    std::getline(std::cin, first_name);
+    std::cout << "Enter second actor name: ";
+    std::getline(std::cin, second_name);
+
+    int *first_index = actor_name_index->search(first_name.c_str());
+    int *second_index = actor_name_index->search(second_name.c_str());
+    if (first_index == nullptr || second_index == nullptr)
+    {
+        std::cout << "Actor not found." << std::endl;
+        return;
+    }
+
+    // Movie lists are sorted, so the shared movies come from one merge
+    int first_count = cast_graph->left(*first_index).size();
+    int second_count = cast_graph->left(*second_index).size();
+    int *common = new int[(first_count < second_count ? first_count : second_count) + 1];
+    int common_count = cast_graph->common(BipartiteGraph::LEFT, *first_index, *second_index, common);
+    if (common_count == 0)
+    {
+        std::cout << "No common movies found." << std::endl;
+        delete[] common;
+        return;
+    }
+
+    AVLTree<std::string> *movie_names = new AVLTree<std::string>();
+    for (int i = 0; i < common_count; i++)
+    {
+        Movie *movie = &movies[common[i]];
+        std::string movie_name = movie->title;
+        movie_name += " (" + std::to_string(movie->year) + ")";
+        movie_names->insertNode(movie_name);
+    }
+    delete[] common;
+
+    std::cout << "Movies starring both " << first_name << " and " << second_name << ":" << std::endl;
+    int i = 1;
+    for (auto it = movie_names->begin(); it != movie_names->end(); ++it)
+    {
+        std::cout << i << ". " << *it << std::endl;
+        i++;
+    }
+    delete movie_names;
+}
+
 void display_add_new_actor()
 {
     // actor details
@@ -421,26 +494,24 @@ void display_add_new_actor()
     std::cout << "Enter the year of birth of " << actor_name << ": ";
     std::cin >> year;
 
-    actor_id = actor_map->getSize();
+    actor_id = actor_id_map->getSize();
 
     // make sure that ids are not duplicated
-    while (actor_map->get(actor_id))
+    while (actor_id_map->get(actor_id))
     {
         actor_id++;
     }
 
     // creation of new actor object
     Actor new_actor;
-    new_actor.name = new char[actor_name.length() + 1];
-    std::strcpy(new_actor.name, actor_name.c_str());
+    new_actor.name = string_arena->copy(actor_name.c_str());
     new_actor.id = actor_id;
     new_actor.year = year;
-    new_actor.movies = new LinkedList<int>();
 
-    // populating of main, and index hashmaps
-    actor_map->insert(actor_id, new_actor);
-    actor_name_index->insert(new_actor.name, actor_id);
-    actor_year_index->insert(year, actor_id);
+    // populating of main table, and index trees
+    int actor_index = append_actor(new_actor);
+    actor_name_index->insert(new_actor.name, actor_index);
+    actor_year_index->insert(year, actor_index);
 }
 void display_add_new_movie()
 {
@@ -456,38 +527,37 @@ void display_add_new_movie()
     std::cin >> year;
 
     // make sure that ids are not duplicated
-    while (movie_map->get(movie_id))
+    while (movie_id_map->get(movie_id))
     {
         movie_id++;
     }
 
     // creation of new movie object
     Movie new_movie;
-    new_movie.title = new char[movie_title.length() + 1];
-    std::strcpy(new_movie.title, movie_title.c_str());
+    new_movie.title = string_arena->copy(movie_title.c_str());
+    new_movie.plot = CSVParser::LazyString();
     new_movie.id = movie_id;
     new_movie.year = year;
-    new_movie.actors = new LinkedList<int>();
 
-    movie_map->insert(movie_id, new_movie);
-    movie_name_index->insert(new_movie.title, movie_id);
-    movie_year_index->insert(new_movie.year, movie_id);
+    int movie_index = append_movie(new_movie);
+    movie_name_index->insert(new_movie.title, movie_index);
+    movie_year_index->insert(new_movie.year, movie_index);
 }
 
 void display_add_actor_to_movie()
 {
     std::string movie_title;
-    int movie_id;
+    int movie_index;
 
     std::cout << "Enter title of movie: ";
     std::cin.ignore();
     std::getline(std::cin, movie_title);
 
     // search for specific movie id by title
-    int *movie_id_ptr = movie_name_index->search(movie_title.c_str());
-    if (movie_id_ptr != nullptr)
+    int *movie_index_ptr = movie_name_index->search(movie_title.c_str());
+    if (movie_index_ptr != nullptr)
     {
-        movie_id = *movie_id_ptr;
+        movie_index = *movie_index_ptr;
     }
     else
     {
@@ -495,9 +565,6 @@ void display_add_actor_to_movie()
         return;
     }
 
-    // obtain cast of movie
-    Movie *movie = movie_map->get(movie_id);
-    LinkedList<int> *actor_ids = movie->actors;
     std::string input;
 
     // add actors to movie
@@ -511,31 +578,25 @@ void display_add_actor_to_movie()
         }
         else
         {
-            int actor_id = *actor_name_index->search(input.c_str());
-            if (actor_ids->contain(actor_id))
+            int actor_index = *actor_name_index->search(input.c_str());
+            if (cast_graph->has_edge(actor_index, movie_index))
             {
                 std::cout << "This actor is already recorded as a cast of the movie." << std::endl;
             }
             else if (input != "0")
             {
-                Actor *actor = actor_map->get(actor_id);
-
-                // add movie to actor's list of involved movies
-                LinkedList<int> *movie_ids = actor->movies;
-                movie_ids->push_back(movie_id);
-
-                // add actor to movie's list of involved actors
-                actor_ids->push_back(actor_id);
+                // link actor and movie in both directions
+                cast_graph->add_edge(actor_index, movie_index);
             }
         }
     } while (input != "0");
 }
 
 // helper function prototypes for updating actor details
-void display_change_actor_name(int actor_id, std::string &actor_name);
-void display_change_add_movie(int actor_id);
-void display_change_remove_movie(int actor_id);
-void display_remove_actor(int actor_id, std::string actor_name);
+void display_change_actor_name(int actor_index, std::string &actor_name);
+void display_change_add_movie(int actor_index);
+void display_change_remove_movie(int actor_index);
+void display_remove_actor(int actor_index, std::string actor_name);
 
 void display_update_actor_details()
 {
@@ -546,13 +607,13 @@ void display_update_actor_details()
     std::getline(std::cin, actor_name);
 
     // search for specific actor id by title
-    int *actor_id_ptr = actor_name_index->search(actor_name.c_str());
-    if (actor_id_ptr == nullptr)
+    int *actor_index_ptr = actor_name_index->search(actor_name.c_str());
+    if (actor_index_ptr == nullptr)
     {
         std::cout << "Actor not found." << std::endl;
         return;
     }
-    int actor_id = *actor_id_ptr;
+    int actor_index = *actor_index_ptr;
 
     int input = 0;
     do
@@ -571,21 +632,19 @@ void display_update_actor_details()
 
         if (input > 0 && input < 5)
         {
-            int actor_index;
-            std::string new_actor_name;
             switch (input)
             {
             case 1:
-                display_change_actor_name(actor_id, actor_name);
+                display_change_actor_name(actor_index, actor_name);
                 break;
             case 2:
-                display_change_add_movie(actor_id);
+                display_change_add_movie(actor_index);
                 break;
             case 3:
-                display_change_remove_movie(actor_id);
+                display_change_remove_movie(actor_index);
                 break;
             case 4:
-                display_remove_actor(actor_id, actor_name);
+                display_remove_actor(actor_index, actor_name);
                 input = 0; // break out of loop after deleting actor
                 break;
             }
@@ -594,10 +653,10 @@ void display_update_actor_details()
 }
 
 // helper function prototypes for updating movie details
-void display_change_movie_title(int movie_id, std::string &movie_title);
-void display_change_add_actor(int movie_id);
-void display_change_remove_actor(int movie_id);
-void display_remove_movie(int movie_id, std::string movie_title);
+void display_change_movie_title(int movie_index, std::string &movie_title);
+void display_change_add_actor(int movie_index);
+void display_change_remove_actor(int movie_index);
+void display_remove_movie(int movie_index, std::string movie_title);
 
 void display_update_movie_details()
 {
@@ -608,13 +667,13 @@ void display_update_movie_details()
     std::getline(std::cin, movie_title);
 
     // search for specific movie id by title
-    int *movie_id_ptr = movie_name_index->search(movie_title.c_str());
-    if (movie_id_ptr == nullptr)
+    int *movie_index_ptr = movie_name_index->search(movie_title.c_str());
+    if (movie_index_ptr == nullptr)
     {
         std::cout << "Movie not found." << std::endl;
         return;
     }
-    int movie_id = *movie_id_ptr;
+    int movie_index = *movie_index_ptr;
 
     int input = 0;
     do
@@ -636,16 +695,16 @@ void display_update_movie_details()
             switch (input)
             {
             case 1:
-                display_change_movie_title(movie_id, movie_title);
+                display_change_movie_title(movie_index, movie_title);
                 break;
             case 2:
-                display_change_add_actor(movie_id);
+                display_change_add_actor(movie_index);
                 break;
             case 3:
-                display_change_remove_actor(movie_id);
+                display_change_remove_actor(movie_index);
                 break;
             case 4:
-                display_remove_movie(movie_id, movie_title);
+                display_remove_movie(movie_index, movie_title);
                 input = 0; // break out of loop after deleting movie
                 break;
             }
@@ -657,28 +716,20 @@ void display_update_movie_details()
 // Helper functions
 // ===============================
 
-AVLTree<std::string> *get_actor_relations(int actor_id, int depth, const std::string &original_name)
+AVLTree<std::string> *get_actor_relations(int actor_index, int depth, const std::string &original_name)
 {
     if (depth <= 0)
         return nullptr;
 
     AVLTree<std::string> *actor_names = new AVLTree<std::string>();
-    Actor *actor = actor_map->get(actor_id);
-
-    LinkedList<int> *actor_movies = actor->movies;
-    if (actor_movies == nullptr)
-        return actor_names;
 
-    for (auto it = actor_movies->begin(); it != actor_movies->end(); ++it)
+    for (int movie_index : cast_graph->left(actor_index))
     {
-        Movie *movie = movie_map->get(*it);
-        LinkedList<int> *movie_actors = movie->actors;
-
-        for (auto it2 = movie_actors->begin(); it2 != movie_actors->end(); ++it2)
+        for (int other_index : cast_graph->right(movie_index))
         {
-            if (*it2 != actor_id)
+            if (other_index != actor_index)
             {
-                Actor *other_actor = actor_map->get(*it2);
+                Actor *other_actor = &actors[other_index];
                 std::string actor_name = other_actor->name;
                 actor_name += " (" + std::to_string(other_actor->year) + ")";
 
@@ -687,7 +738,7 @@ AVLTree<std::string> *get_actor_relations(int actor_id, int depth, const std::st
                 {
                     actor_names->insertNode(actor_name);
 
-                    AVLTree<std::string> *deeper_relations = get_actor_relations(*it2, depth - 1, original_name);
+                    AVLTree<std::string> *deeper_relations = get_actor_relations(other_index, depth - 1, original_name);
                     if (deeper_relations != nullptr)
                     {
                         for (auto deeper_it = deeper_relations->begin(); deeper_it != deeper_relations->end(); ++deeper_it)
@@ -703,168 +754,425 @@ AVLTree<std::string> *get_actor_relations(int actor_id, int depth, const std::st
     return actor_names;
 }
 
-void populate_main_hashmap()
+void add_cast_relations(const ActorMovie *rows, size_t count, void *context)
 {
-    // Initialise hashmap cache
-    HashMap<int, LinkedList<int>> *actor_movies = new HashMap<int, LinkedList<int>>(actor_movie_count);
-    HashMap<int, LinkedList<int>> *movie_actors = new HashMap<int, LinkedList<int>>(actor_movie_count);
+    bool filling = *static_cast<bool *>(context);
+    const size_t CHUNK = 256;
+    int actor_ids[CHUNK], movie_ids[CHUNK];
+    int *actor_indices[CHUNK], *movie_indices[CHUNK];
 
-    // For each actor movie relation, populate hashmaps caches
-    for (size_t i = 0; i < actor_movie_count; i++)
+    for (size_t first = 0; first < count; first += CHUNK)
     {
-        ActorMovie relationship = actor_movies_csv[i];
-        int actor_id = relationship.actor_id;
-        int movie_id = relationship.movie_id;
+        size_t chunk = count - first < CHUNK ? count - first : CHUNK;
 
-        LinkedList<int> *actor_movies_list = actor_movies->get(actor_id);
-        if (actor_movies_list == nullptr)
+        // Translate a chunk of ids at once, so the id map lookups overlap
+        for (size_t i = 0; i < chunk; i++)
         {
-            actor_movies->insert(actor_id, LinkedList<int>());
-            actor_movies_list = actor_movies->get(actor_id);
+            actor_ids[i] = rows[first + i].actor_id;
+            movie_ids[i] = rows[first + i].movie_id;
         }
-        actor_movies_list->push_back(movie_id);
+        actor_id_map->get_batch(actor_ids, chunk, actor_indices);
+        movie_id_map->get_batch(movie_ids, chunk, movie_indices);
 
-        LinkedList<int> *movie_actors_list = movie_actors->get(movie_id);
-        if (movie_actors_list == nullptr)
+        // For each actor movie relation, count it or place it in the graph
+        for (size_t i = 0; i < chunk; i++)
         {
-            movie_actors->insert(movie_id, LinkedList<int>());
-            movie_actors_list = movie_actors->get(movie_id);
+            // Skip relations to ids missing from the actor or movie file
+            if (actor_indices[i] == nullptr || movie_indices[i] == nullptr)
+            {
+                continue;
+            }
+
+            if (filling)
+            {
+                cast_graph->fill_edge(*actor_indices[i], *movie_indices[i]);
+            }
+            else
+            {
+                cast_graph->count_edge(*actor_indices[i], *movie_indices[i]);
+            }
         }
-        movie_actors_list->push_back(actor_id);
     }
+}
 
-    // Loop through actors and movies and populate their relations
-    for (size_t i = 0; i < actor_count; i++)
+void load_csv_files(bool keep_arrays)
+{
+    StartupContext context;
+
+    // Parse each CSV file across all hardware threads, keeping strings in one arena
+    context.actor_options.threads = 0;
+    context.actor_options.arena = string_arena;
+    context.cast_options = context.actor_options;
+
+    // Movies parse alongside actors, so their strings go to a second arena first.
+    // Movie plots are never listed, so they stay in the mapped file until fetched
+    StringArena *movie_arena = new StringArena();
+    context.movie_options = context.actor_options;
+    context.movie_options.arena = movie_arena;
+    context.movie_options.lazyColumns = 1u << CSVParser::Traits<Movie>::PLOT;
+    context.movie_options.source = movie_source;
+
+    // Index trees are filled from the bulk-load stages
+    create_index_trees();
+    keep_index_arrays = keep_arrays;
+
+    // Actors and movies load concurrently. Each index builds as soon as its
+    // table is ready, and overlaps with the cast file, which needs both id maps
+    // to translate its rows to table indices
+    Pipeline startup;
+    int actor_stage = startup.add("parse actors", parse_actors, &context);
+    int movie_stage = startup.add("parse movies", parse_movies, &context);
+    unsigned actors_ready = 1u << actor_stage;
+    unsigned movies_ready = 1u << movie_stage;
+    int actor_ids_stage = startup.add("actor id map", populate_actor_id_map, nullptr, actors_ready);
+    int movie_ids_stage = startup.add("movie id map", populate_movie_id_map, nullptr, movies_ready);
+
+    startup.add("parse cast", parse_cast, &context, (1u << actor_ids_stage) | (1u << movie_ids_stage));
+    startup.add("actor name index", [](void *) { populate_actor_name_index(); }, nullptr, actors_ready);
+    startup.add("actor year index", [](void *) { populate_actor_year_index(); }, nullptr, actors_ready);
+    startup.add("movie name index", [](void *) { populate_movie_name_index(); }, nullptr, movies_ready);
+    startup.add("movie year index", [](void *) { populate_movie_year_index(); }, nullptr, movies_ready);
+    startup.run();
+
+    string_arena->adopt(*movie_arena);
+    delete movie_arena;
+
+    DEBUG_PRINTF("Loaded %zu actors, %zu movies and %zu cast relations\n", actor_count, movie_count, actor_movie_count);
+    for (int i = 0; i < startup.size(); i++)
     {
-        Actor *actor = &actors[i];
-        LinkedList<int> *actor_movie = actor_movies->get(actor->id);
-        if (actor_movie == nullptr)
-        {
-            actor->movies = new LinkedList<int>();
-        }
-        else
-        {
-            actor->movies = actor_movie;
-        }
-        actor_map->insert(actor->id, *actor);
+        DEBUG_PRINTF("  %-18s started %6.3fs, took %6.3fs\n", startup.name(i), startup.start(i), startup.seconds(i));
+    }
+    DEBUG_PRINTF("Startup pipeline took %.2f seconds\n", startup.totalSeconds());
+
+#ifdef DEBUG
+    print_hash_stats("actor id map", actor_id_map->stats());
+    print_hash_stats("movie id map", movie_id_map->stats());
+#endif
+    DEBUG_PRINTF("Cast graph: %zu edges, %.1f KiB\n", cast_graph->edgeCount(), cast_graph->memory_usage() / 1024.0);
+}
+
+void parse_actors(void *context)
+{
+    StartupContext *startup = static_cast<StartupContext *>(context);
+    actors = CSVParser::ParseMapped<Actor>(ACTORS_CSV, &actor_count, startup->actor_options);
+    actor_capacity = actor_count;
+}
+
+void parse_movies(void *context)
+{
+    StartupContext *startup = static_cast<StartupContext *>(context);
+    movies = CSVParser::ParseMapped<Movie>(MOVIES_CSV, &movie_count, startup->movie_options);
+    movie_capacity = movie_count;
+}
+
+void parse_cast(void *context)
+{
+    StartupContext *startup = static_cast<StartupContext *>(context);
+
+    // Stream the cast file twice, no relation array is kept: the first pass
+    // counts every actor's and movie's relations, which sizes the graph, and
+    // the second writes each relation into its place
+    bool filling = false;
+    cast_graph->begin_count(actor_count, movie_count);
+    actor_movie_count = CSVParser::ForEach<ActorMovie>(CAST_CSV, add_cast_relations, &filling, startup->cast_options);
+
+    filling = true;
+    cast_graph->begin_fill();
+    CSVParser::ForEach<ActorMovie>(CAST_CSV, add_cast_relations, &filling, startup->cast_options);
+    cast_graph->end_fill();
+}
+
+void populate_actor_id_map(void *)
+{
+    actor_id_map = freeze_id_map(actors, actor_count);
+}
+
+void populate_movie_id_map(void *)
+{
+    movie_id_map = freeze_id_map(movies, movie_count);
+}
+
+template <typename T>
+FrozenHashMap<int, int> *freeze_id_map(const T *table, size_t count)
+{
+    // The id set only changes through the admin panel, so the map is built
+    // once as a perfect hash: one probe per cast row on load
+    int *ids = new int[count + 1];
+    int *indices = new int[count + 1];
+    for (size_t i = 0; i < count; i++)
+    {
+        ids[i] = table[i].id;
+        indices[i] = i;
     }
 
-    for (size_t i = 0; i < movie_count; i++)
+    FrozenHashMap<int, int> *id_map = new FrozenHashMap<int, int>(ids, indices, count);
+    delete[] ids;
+    delete[] indices;
+    return id_map;
+}
+
+int append_actor(const Actor &actor)
+{
+    // Grow the table geometrically; Actor pointers into it do not survive this
+    if (actor_count == actor_capacity)
     {
-        Movie *movie = &movies[i];
-        LinkedList<int> *movie_actor = movie_actors->get(movie->id);
-        if (movie_actor == nullptr)
-        {
-            movie->actors = new LinkedList<int>();
-        }
-        else
-        {
-            movie->actors = movie_actor;
-        }
-        movie_map->insert(movie->id, *movie);
+        actor_capacity = actor_capacity ? actor_capacity * 2 : 16;
+        actors = static_cast<Actor *>(realloc(actors, actor_capacity * sizeof(Actor)));
     }
+
+    actors[actor_count] = actor;
+    actor_id_map->insert(actor.id, actor_count);
+    return actor_count++;
 }
 
-void populate_actor_indices()
+int append_movie(const Movie &movie)
 {
-    populate_actor_name_index();
-    populate_actor_year_index();
+    // Grow the table geometrically; Movie pointers into it do not survive this
+    if (movie_count == movie_capacity)
+    {
+        movie_capacity = movie_capacity ? movie_capacity * 2 : 16;
+        movies = static_cast<Movie *>(realloc(movies, movie_capacity * sizeof(Movie)));
+    }
+
+    movies[movie_count] = movie;
+    movie_id_map->insert(movie.id, movie_count);
+    return movie_count++;
 }
 
 void populate_actor_name_index()
 {
-    DEBUG_PRINTF("Populating actor name index...\n");
-    Actor *actors_copy = new Actor[actor_count];
-    memcpy(actors_copy, actors, sizeof(Actor) * actor_count);
+    Actor *actors_copy = copy_actors_for_sort();
     quicksort<Actor>(actors_copy, 0, actor_count - 1, compare_actor_name);
 
     const char **names = new const char *[actor_count];
-    int *ids = new int[actor_count];
+    int *indices = new int[actor_count];
     for (size_t i = 0; i < actor_count; ++i)
     {
         names[i] = actors_copy[i].name;
-        ids[i] = actors_copy[i].id;
+        indices[i] = actors_copy[i].id; // table index, see copy_actors_for_sort
     }
 
-    actor_name_index->bulk_load(names, ids, actor_count);
+    actor_name_index->bulk_load(names, indices, actor_count);
 
     delete[] actors_copy;
-    delete[] names;
-    delete[] ids;
+    if (keep_index_arrays)
+    {
+        snapshot_data.actor_names = names;
+        snapshot_data.actor_name_indices = indices;
+    }
+    else
+    {
+        delete[] names;
+        delete[] indices;
+    }
 }
 
 void populate_actor_year_index()
 {
-    DEBUG_PRINTF("Populating actor year index...\n");
-    Actor *actors_copy = new Actor[actor_count];
-    memcpy(actors_copy, actors, sizeof(Actor) * actor_count);
+    Actor *actors_copy = copy_actors_for_sort();
     quicksort<Actor>(actors_copy, 0, actor_count - 1, compare_actor_year);
 
     int *years = new int[actor_count];
-    int *ids = new int[actor_count];
+    int *indices = new int[actor_count];
     for (size_t i = 0; i < actor_count; ++i)
     {
         years[i] = actors_copy[i].year;
-        ids[i] = actors_copy[i].id;
+        indices[i] = actors_copy[i].id; // table index, see copy_actors_for_sort
     }
 
-    actor_year_index->bulk_load(years, ids, actor_count);
+    actor_year_index->bulk_load(years, indices, actor_count);
 
     delete[] actors_copy;
-    delete[] years;
-    delete[] ids;
-}
-
-void populate_movie_indices()
-{
-    populate_movie_name_index();
-    populate_movie_year_index();
+    if (keep_index_arrays)
+    {
+        snapshot_data.actor_years = years;
+        snapshot_data.actor_year_indices = indices;
+    }
+    else
+    {
+        delete[] years;
+        delete[] indices;
+    }
 }
 
 void populate_movie_name_index()
 {
-    DEBUG_PRINTF("Populating movie name index...\n");
-    Movie *movies_copy = new Movie[movie_count];
-    memcpy(movies_copy, movies, sizeof(Movie) * movie_count);
+    Movie *movies_copy = copy_movies_for_sort();
     quicksort<Movie>(movies_copy, 0, movie_count - 1, compare_movie_title);
 
     const char **titles = new const char *[movie_count];
-    int *ids = new int[movie_count];
+    int *indices = new int[movie_count];
     for (size_t i = 0; i < movie_count; ++i)
     {
         titles[i] = movies_copy[i].title;
-        ids[i] = movies_copy[i].id;
+        indices[i] = movies_copy[i].id; // table index, see copy_movies_for_sort
     }
 
-    movie_name_index->bulk_load(titles, ids, movie_count);
+    movie_name_index->bulk_load(titles, indices, movie_count);
 
     delete[] movies_copy;
-    delete[] titles;
-    delete[] ids;
+    if (keep_index_arrays)
+    {
+        snapshot_data.movie_titles = titles;
+        snapshot_data.movie_title_indices = indices;
+    }
+    else
+    {
+        delete[] titles;
+        delete[] indices;
+    }
 }
 
 void populate_movie_year_index()
 {
-    DEBUG_PRINTF("Populating movie year index...\n");
-    Movie *movies_copy = new Movie[movie_count];
-    memcpy(movies_copy, movies, sizeof(Movie) * movie_count);
+    Movie *movies_copy = copy_movies_for_sort();
     quicksort<Movie>(movies_copy, 0, movie_count - 1, compare_movie_year);
 
     int *years = new int[movie_count];
-    int *ids = new int[movie_count];
+    int *indices = new int[movie_count];
     for (size_t i = 0; i < movie_count; ++i)
     {
         years[i] = movies_copy[i].year;
-        ids[i] = movies_copy[i].id;
+        indices[i] = movies_copy[i].id; // table index, see copy_movies_for_sort
     }
 
-    movie_year_index->bulk_load(years, ids, movie_count);
+    movie_year_index->bulk_load(years, indices, movie_count);
 
     delete[] movies_copy;
-    delete[] years;
-    delete[] ids;
+    if (keep_index_arrays)
+    {
+        snapshot_data.movie_years = years;
+        snapshot_data.movie_year_indices = indices;
+    }
+    else
+    {
+        delete[] years;
+        delete[] indices;
+    }
+}
+
+// The index trees map keys to table indices, so the sorted copies carry each
+// entry's table index in place of its id. Only the sort fields are copied.
+// The cast stage runs alongside, but it only writes the cast graph, so the
+// tables are read-only here
+Actor *copy_actors_for_sort()
+{
+    Actor *actors_copy = new Actor[actor_count]();
+    for (size_t i = 0; i < actor_count; ++i)
+    {
+        actors_copy[i].id = i;
+        actors_copy[i].name = actors[i].name;
+        actors_copy[i].year = actors[i].year;
+    }
+    return actors_copy;
 }
 
+Movie *copy_movies_for_sort()
+{
+    Movie *movies_copy = new Movie[movie_count]();
+    for (size_t i = 0; i < movie_count; ++i)
+    {
+        movies_copy[i].id = i;
+        movies_copy[i].title = movies[i].title;
+        movies_copy[i].year = movies[i].year;
+    }
+    return movies_copy;
+}
+
+void create_index_trees()
+{
+    actor_name_index = new BPlusTree<const char *, int>();
+    movie_name_index = new BPlusTree<const char *, int>();
+
+    actor_year_index = new BPlusTree<int, int>();
+    movie_year_index = new BPlusTree<int, int>();
+}
+
+bool load_snapshot(const char *path)
+{
+    const char *sources[] = {ACTORS_CSV, MOVIES_CSV, CAST_CSV};
+    Snapshot::Data data;
+    data.cast = cast_graph;
+    if (!Snapshot::Load(path, data, sources, 3))
+    {
+        DEBUG_PRINTF("Snapshot %s missing or stale, rebuilding from CSV files\n", path);
+        return false;
+    }
+
+    actors = data.actors;
+    actor_count = actor_capacity = data.actor_count;
+    movies = data.movies;
+    movie_count = movie_capacity = data.movie_count;
+
+    // Lazy movie plots still refer to the movie CSV
+    movie_source->open(MOVIES_CSV);
+
+    // Tables and the cast graph are stored by table index, only the id maps are rebuilt
+    create_index_trees();
+    actor_id_map = freeze_id_map(actors, actor_count);
+    movie_id_map = freeze_id_map(movies, movie_count);
+
+    // Index arrays are stored already sorted
+    actor_name_index->bulk_load(data.actor_names, data.actor_name_indices, actor_count);
+    actor_year_index->bulk_load(data.actor_years, data.actor_year_indices, actor_count);
+    movie_name_index->bulk_load(data.movie_titles, data.movie_title_indices, movie_count);
+    movie_year_index->bulk_load(data.movie_years, data.movie_year_indices, movie_count);
+
+    delete[] data.actor_names;
+    delete[] data.movie_titles;
+    return true;
+}
+
+void write_snapshot(const char *path)
+{
+    const char *sources[] = {ACTORS_CSV, MOVIES_CSV, CAST_CSV};
+    snapshot_data.actors = actors;
+    snapshot_data.actor_count = actor_count;
+    snapshot_data.movies = movies;
+    snapshot_data.movie_count = movie_count;
+    snapshot_data.cast = cast_graph;
+
+    try
+    {
+        Snapshot::Write(path, snapshot_data, sources, 3);
+    }
+    catch (const char *error)
+    {
+        std::cout << "Could not write snapshot: " << error << std::endl;
+    }
+
+    delete[] snapshot_data.actor_names;
+    delete[] snapshot_data.actor_name_indices;
+    delete[] snapshot_data.actor_years;
+    delete[] snapshot_data.actor_year_indices;
+    delete[] snapshot_data.movie_titles;
+    delete[] snapshot_data.movie_title_indices;
+    delete[] snapshot_data.movie_years;
+    delete[] snapshot_data.movie_year_indices;
+    keep_index_arrays = false;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+#ifdef DEBUG
+void print_hash_stats(const char *name, const HashStats &stats)
+{
+    char histogram[HashStats::HISTOGRAM_SIZE * 12] = "";
+    int length = 0;
+    for (int i = 0; i < HashStats::HISTOGRAM_SIZE; i++)
+    {
+        length += snprintf(histogram + length, sizeof(histogram) - length, " %d", stats.histogram[i]);
+    }
+
+    DEBUG_PRINTF("%s: %d entries, %d/%d used (load %.2f), %.1f KiB, longest %d, %.2f average probe, histogram%s\n",
+                 name, stats.size, stats.used, stats.capacity, stats.loadFactor, stats.bytes / 1024.0,
+                 stats.longest, stats.averageProbe, histogram);
+}
+#endif
+
 int get_year()
 {
     std::time_t t = std::time(0);
@@ -872,35 +1180,25 @@ int get_year()
     return now->tm_year + 1900;
 }
 
-void display_change_actor_name(int actor_id, std::string &actor_name)
+void display_change_actor_name(int actor_index, std::string &actor_name)
 {
     std::string new_actor_name;
     std::cout << "Enter new name for " << actor_name << ": ";
     std::cin.ignore();
     std::getline(std::cin, new_actor_name);
-    // obtain actor_index
-    int actor_index = actor_id;
-    // update actor name
-    Actor updated_actor = *actor_map->get(actor_index);
-    updated_actor.name = new char[new_actor_name.length() + 1];
-    std::strcpy(updated_actor.name, new_actor_name.c_str());
 
-    // update main actor hashmap
-    actor_map->insert(actor_index, updated_actor);
+    // update actor name in the main table
+    Actor *actor = &actors[actor_index];
+    actor->name = string_arena->copy(new_actor_name.c_str());
 
     // update actor index
-    actor_name_index->insert(new_actor_name.c_str(), actor_index);
     actor_name_index->remove(actor_name.c_str());
-    actor_name_index->insert(updated_actor.name, actor_index);
+    actor_name_index->insert(actor->name, actor_index);
 }
 
-void display_change_add_movie(int actor_id)
+void display_change_add_movie(int actor_index)
 {
 
-    // obtain actor movie list to add to
-    Actor *actor = actor_map->get(actor_id);
-    LinkedList<int> *actor_movies = actor->movies;
-
     std::string movie_title;
     std::cin.ignore(); // ignore any leftover newline character in the input buffer
     do
@@ -911,24 +1209,19 @@ void display_change_add_movie(int actor_id)
         // search for specific movie id by title
         if (movie_title != "0")
         {
-            int *movie_id_ptr = movie_name_index->search(movie_title.c_str());
-            if (movie_id_ptr != nullptr)
+            int *movie_index_ptr = movie_name_index->search(movie_title.c_str());
+            if (movie_index_ptr != nullptr)
             {
-                int movie_id = *movie_id_ptr;
-
-                // modify movie list to reflect actor involvement
-                Movie *movie = movie_map->get(movie_id);
-                LinkedList<int> *actor_list = movie->actors;
+                int movie_index = *movie_index_ptr;
 
                 // check if actor is already involved in movie
-                if (actor_list->contain(actor_id))
+                if (cast_graph->has_edge(actor_index, movie_index))
                 {
                     std::cout << "This actor is already recorded as a cast of the movie." << std::endl;
                     return;
                 }
 
-                actor_movies->push_back(movie_id);
-                actor_list->push_back(actor_id);
+                cast_graph->add_edge(actor_index, movie_index);
             }
             else
             {
@@ -939,12 +1232,8 @@ void display_change_add_movie(int actor_id)
     } while (movie_title != "0");
 }
 
-void display_change_remove_movie(int actor_id)
+void display_change_remove_movie(int actor_index)
 {
-    // obtain actor movie list to remove from
-    Actor *actor = actor_map->get(actor_id);
-    LinkedList<int> *actor_movies = actor->movies;
-
     std::string movie_title;
     std::cin.ignore(); // ignore any leftover newline character in the input buffer
     do
@@ -955,24 +1244,17 @@ void display_change_remove_movie(int actor_id)
         // search for specific movie id by title
         if (movie_title != "0")
         {
-            int *movie_id_ptr = movie_name_index->search(movie_title.c_str());
-            if (movie_id_ptr != nullptr)
+            int *movie_index_ptr = movie_name_index->search(movie_title.c_str());
+            if (movie_index_ptr != nullptr)
             {
-                int movie_id = *movie_id_ptr;
+                int movie_index = *movie_index_ptr;
 
-                // modify movie list to reflect actor removal
-                Movie *movie = movie_map->get(movie_id);
-                LinkedList<int> *actor_list = movie->actors;
-
-                // check if actor is involved in movie
-                if (!actor_list->contain(actor_id))
+                // check if actor is involved in movie, then unlink both sides
+                if (!cast_graph->remove_edge(actor_index, movie_index))
                 {
                     std::cout << "This actor is not recorded as a cast of the movie." << std::endl;
                     return;
                 }
-
-                actor_movies->remove(movie_id);
-                actor_list->remove(actor_id);
             }
             else
             {
@@ -983,14 +1265,12 @@ void display_change_remove_movie(int actor_id)
     } while (movie_title != "0");
 }
 
-void display_remove_actor(int actor_id, std::string actor_name)
+void display_remove_actor(int actor_index, std::string actor_name)
 {
-    // Retrieve actor and their movies
-    Actor *actor = actor_map->get(actor_id);
-    LinkedList<int> *actor_movies = actor->movies;
+    Actor *actor = &actors[actor_index];
 
-    // Remove actor from actor_map
-    actor_map->remove(actor_id);
+    // Remove actor from actor_id_map, the table entry stays as a tombstone
+    actor_id_map->remove(actor->id);
 
     // Remove actor from actor_name_index
     actor_name_index->remove(actor_name.c_str());
@@ -999,45 +1279,31 @@ void display_remove_actor(int actor_id, std::string actor_name)
     actor_year_index->remove(actor->year);
 
     // Remove actor from all movies they are associated with
-    for (auto it = actor_movies->begin(); it != actor_movies->end(); ++it)
-    {
-        Movie *movie = movie_map->get(*it);
-        movie->actors->remove(actor_id);
-    }
+    cast_graph->clear_vertex(BipartiteGraph::LEFT, actor_index);
 
-    // Free memory allocated for actor name
-    delete[] actor->name;
-    delete actor_movies;
+    // Actor name stays in the string arena until shutdown
 }
 
-void display_change_movie_title(int movie_id, std::string &movie_title)
+void display_change_movie_title(int movie_index, std::string &movie_title)
 {
     std::string new_movie_title;
     std::cout << "Enter new title for " << movie_title << ": ";
     std::cin.ignore();
     std::getline(std::cin, new_movie_title);
 
-    // Update movie title
-    Movie updated_movie = *movie_map->get(movie_id);
-    updated_movie.title = new char[new_movie_title.length() + 1];
-    std::strcpy(updated_movie.title, new_movie_title.c_str());
-
-    // Update main movie hashmap
-    movie_map->insert(movie_id, updated_movie);
+    // Update movie title in the main table
+    Movie *movie = &movies[movie_index];
+    movie->title = string_arena->copy(new_movie_title.c_str());
 
     // Update movie index
     movie_name_index->remove(movie_title.c_str());
-    movie_name_index->insert(updated_movie.title, movie_id);
+    movie_name_index->insert(movie->title, movie_index);
 
     movie_title = new_movie_title;
 }
 
-void display_change_add_actor(int movie_id)
+void display_change_add_actor(int movie_index)
 {
-    // Obtain movie actor list to add to
-    Movie *movie = movie_map->get(movie_id);
-    LinkedList<int> *movie_actors = movie->actors;
-
     std::string actor_name;
     std::cin.ignore();
     do
@@ -1048,24 +1314,19 @@ void display_change_add_actor(int movie_id)
         // Search for specific actor id by name
         if (actor_name != "0")
         {
-            int *actor_id_ptr = actor_name_index->search(actor_name.c_str());
-            if (actor_id_ptr != nullptr)
+            int *actor_index_ptr = actor_name_index->search(actor_name.c_str());
+            if (actor_index_ptr != nullptr)
             {
-                int actor_id = *actor_id_ptr;
-
-                // Modify actor list to reflect movie involvement
-                Actor *actor = actor_map->get(actor_id);
-                LinkedList<int> *movie_list = actor->movies;
+                int actor_index = *actor_index_ptr;
 
                 // Check if actor is already involved in movie
-                if (movie_actors->contain(actor_id))
+                if (cast_graph->has_edge(actor_index, movie_index))
                 {
                     std::cout << "This actor is already recorded as a cast of the movie." << std::endl;
                     return;
                 }
 
-                movie_actors->push_back(actor_id);
-                movie_list->push_back(movie_id);
+                cast_graph->add_edge(actor_index, movie_index);
             }
             else
             {
@@ -1076,12 +1337,8 @@ void display_change_add_actor(int movie_id)
     } while (actor_name != "0");
 }
 
-void display_change_remove_actor(int movie_id)
+void display_change_remove_actor(int movie_index)
 {
-    // Obtain movie actor list to remove from
-    Movie *movie = movie_map->get(movie_id);
-    LinkedList<int> *movie_actors = movie->actors;
-
     std::string actor_name;
     std::cin.ignore();
     do
@@ -1092,24 +1349,17 @@ void display_change_remove_actor(int movie_id)
         // Search for specific actor id by name
         if (actor_name != "0")
         {
-            int *actor_id_ptr = actor_name_index->search(actor_name.c_str());
-            if (actor_id_ptr != nullptr)
+            int *actor_index_ptr = actor_name_index->search(actor_name.c_str());
+            if (actor_index_ptr != nullptr)
             {
-                int actor_id = *actor_id_ptr;
-
-                // Modify actor list to reflect actor removal
-                Actor *actor = actor_map->get(actor_id);
-                LinkedList<int> *movie_list = actor->movies;
+                int actor_index = *actor_index_ptr;
 
-                // Check if actor is involved in movie
-                if (!movie_actors->contain(actor_id))
+                // Check if actor is involved in movie, then unlink both sides
+                if (!cast_graph->remove_edge(actor_index, movie_index))
                 {
                     std::cout << "This actor is not recorded as a cast of the movie." << std::endl;
                     return;
                 }
-
-                movie_actors->remove(actor_id);
-                movie_list->remove(movie_id);
             }
             else
             {
@@ -1120,12 +1370,12 @@ void display_change_remove_actor(int movie_id)
     } while (actor_name != "0");
 }
 
-void display_remove_movie(int movie_id, std::string movie_title)
+void display_remove_movie(int movie_index, std::string movie_title)
 {
-    Movie *movie = movie_map->get(movie_id);
+    Movie *movie = &movies[movie_index];
 
-    // Remove movie from movie_map
-    movie_map->remove(movie_id);
+    // Remove movie from movie_id_map, the table entry stays as a tombstone
+    movie_id_map->remove(movie->id);
 
     // Remove movie from movie_name_index
     movie_name_index->remove(movie_title.c_str());
@@ -1134,14 +1384,7 @@ void display_remove_movie(int movie_id, std::string movie_title)
     movie_year_index->remove(movie->year);
 
     // Remove movie from all actors associated with it
-    LinkedList<int> *movie_actors = movie->actors;
-    for (auto it = movie_actors->begin(); it != movie_actors->end(); ++it)
-    {
-        Actor *actor = actor_map->get(*it);
-        actor->movies->remove(movie_id);
-    }
+    cast_graph->clear_vertex(BipartiteGraph::RIGHT, movie_index);
 
-    // Free memory allocated for movie title
-    delete[] movie->title;
-    delete movie_actors;
+    // Movie title stays in the string arena until shutdown
 }
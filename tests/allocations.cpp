@@ -0,0 +1,153 @@
+// Heap allocations of the load path and of admin edits. Every operator new
+// in this program is counted, and the checks pin down which operations may
+// allocate at all: entries are built in place rather than copied in, lookups
+// of existing keys never allocate, and building the cast graph costs a fixed
+// number of arrays however many edges it has.
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "dst/bipartitegraph.h"
+#include "dst/bplustree.h"
+#include "dst/flathashmap.h"
+#include "dst/hashmap.h"
+
+#include "check.h"
+
+static size_t allocations = 0;
+
+void* operator new(size_t bytes) {
+    ++allocations;
+    void* memory = malloc(bytes ? bytes : 1);
+    if(memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+// Allocations made while running f
+template<typename F>
+static size_t allocationsDuring(F f) {
+    size_t before = allocations;
+    f();
+    return allocations - before;
+}
+
+static const int KEYS = 10000;
+
+// Long enough that every std::string holding it allocates
+static const char* TEXT = "a value well past the small string buffer";
+
+// Cast graph over actors * moviesPerActor edges, built in two passes like the
+// loader does from the cast rows
+static size_t castGraphBuild(int actors, int moviesPerActor) {
+    int movies = actors / 2 + moviesPerActor;
+    BipartiteGraph graph;
+    return allocationsDuring([&]() {
+        graph.begin_count(actors, movies);
+        for(int a = 0; a < actors; a++) {
+            for(int m = 0; m < moviesPerActor; m++) graph.count_edge(a, a / 2 + m);
+        }
+        graph.begin_fill();
+        for(int a = 0; a < actors; a++) {
+            for(int m = 0; m < moviesPerActor; m++) graph.fill_edge(a, a / 2 + m);
+        }
+        graph.end_fill();
+    });
+}
+
+static void checkCastGraph() {
+    // Offsets, neighbours and build cursors for each side, nothing per edge
+    size_t small = castGraphBuild(1000, 4);
+    size_t large = castGraphBuild(100000, 4);
+    CHECK(small == large);
+    CHECK(large <= 6);
+
+    // Admin edits copy a vertex's few neighbours into an inline delta row
+    BipartiteGraph graph;
+    graph.begin_count(4, 4);
+    graph.count_edge(0, 0);
+    graph.begin_fill();
+    graph.fill_edge(0, 0);
+    graph.end_fill();
+    CHECK(allocationsDuring([&]() { graph.add_edge(0, 1); }) == 0);
+    CHECK(allocationsDuring([&]() { graph.add_edge(0, 2); }) == 0);
+    CHECK(allocationsDuring([&]() { graph.remove_edge(0, 1); }) == 0);
+}
+
+// Building each value in place allocates once per value, copying one in
+// allocates a second time. Nodes come from the map's pool, a block at a time
+template<typename Map>
+static void checkEmplace(int nodeBlocks) {
+    Map built(KEYS * 2);
+    size_t emplaced = allocationsDuring([&]() {
+        for(int i = 0; i < KEYS; i++) built.emplace(i, TEXT);
+    });
+    CHECK(emplaced <= static_cast<size_t>(KEYS + nodeBlocks));
+
+    Map copied(KEYS * 2);
+    size_t copies = allocationsDuring([&]() {
+        for(int i = 0; i < KEYS; i++) {
+            std::string value(TEXT);
+            copied.insert(i, value);
+        }
+    });
+    CHECK(copies >= static_cast<size_t>(2 * KEYS));
+
+    // Existing keys are found, not replaced or copied
+    size_t lookups = allocationsDuring([&]() {
+        for(int i = 0; i < KEYS; i++) {
+            built.insert_or_get(i);
+            built.try_emplace(i, TEXT);
+        }
+    });
+    CHECK(lookups == 0);
+
+    // Moving hands the storage over, whatever the size
+    size_t moves = allocationsDuring([&]() {
+        Map moved(std::move(built));
+        built = std::move(moved);
+    });
+    CHECK(moves <= 6);
+    CHECK(built.getSize() == KEYS);
+}
+
+// Values live inline in the leaves, so keys that fit the existing leaves
+// allocate nothing, and a tree only allocates when a node splits
+static void checkTree() {
+    BPlusTree<int, int> tree;
+    size_t inserted = allocationsDuring([&]() {
+        for(int i = 0; i < 4000; i++) tree.emplace(i, i);
+    });
+    CHECK(inserted == 0);
+
+    size_t lookups = allocationsDuring([&]() {
+        for(int i = 0; i < 4000; i++) tree.insert_or_get(i);
+    });
+    CHECK(lookups == 0);
+
+    // The load path: one allocation per node, nothing per key
+    static int keys[KEYS * 4], values[KEYS * 4];
+    for(int i = 0; i < KEYS * 4; i++) keys[i] = values[i] = i;
+    size_t loaded = allocationsDuring([&]() { tree.bulk_load(keys, values, KEYS * 4); });
+    CHECK(loaded <= 16);
+    CHECK(tree.search(KEYS * 4 - 1) != nullptr);
+}
+
+int main() {
+    checkCastGraph();
+    // Pool blocks double from 16 nodes, 13 blocks cover every key
+    checkEmplace<HashMap<int, std::string>>(16);
+    checkEmplace<FlatHashMap<int, std::string>>(0);
+    checkTree();
+
+    return report("allocations");
+}
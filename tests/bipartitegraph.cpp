@@ -0,0 +1,167 @@
+// Random edits of a BipartiteGraph (see dst/bipartitegraph.h) against a
+// reference list of edges: adds, removes and cleared vertices, on vertices
+// inside and past the CSR range, with compactions forced by hand and ones
+// triggered by the delta row count
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "dst/bipartitegraph.h"
+
+#include "check.h"
+
+typedef std::vector<std::pair<int, int>> Edges;
+
+// Every vertex on both sides has exactly the reference neighbours, repeats
+// included, in ascending order
+static void checkGraph(const BipartiteGraph& graph, const Edges& edges) {
+    int leftCount = 0, rightCount = 0;
+    for(const auto& edge : edges) {
+        leftCount = std::max(leftCount, edge.first + 1);
+        rightCount = std::max(rightCount, edge.second + 1);
+    }
+    CHECK(graph.vertexCount(BipartiteGraph::LEFT) >= leftCount);
+    CHECK(graph.vertexCount(BipartiteGraph::RIGHT) >= rightCount);
+    CHECK(graph.edgeCount() == edges.size());
+
+    std::vector<std::vector<int>> left(graph.vertexCount(BipartiteGraph::LEFT));
+    std::vector<std::vector<int>> right(graph.vertexCount(BipartiteGraph::RIGHT));
+    for(const auto& edge : edges) {
+        left[edge.first].push_back(edge.second);
+        right[edge.second].push_back(edge.first);
+    }
+    int mismatched = 0;
+    for(size_t v = 0; v < left.size(); v++) {
+        std::sort(left[v].begin(), left[v].end());
+        BipartiteGraph::Range range = graph.left(static_cast<int>(v));
+        mismatched += std::vector<int>(range.begin(), range.end()) != left[v];
+    }
+    for(size_t v = 0; v < right.size(); v++) {
+        std::sort(right[v].begin(), right[v].end());
+        BipartiteGraph::Range range = graph.right(static_cast<int>(v));
+        mismatched += std::vector<int>(range.begin(), range.end()) != right[v];
+    }
+    CHECK(mismatched == 0);
+}
+
+static void removeAt(Edges& edges, size_t i) {
+    edges[i] = edges.back();
+    edges.pop_back();
+}
+
+// ops random edits, compact() by hand every forceEvery of them (0 = never).
+// New vertices go up to spread past the current vertex counts
+static void randomEdits(BipartiteGraph& graph, Edges& edges, std::mt19937& random,
+                        int ops, int forceEvery, int spread) {
+    int automatic = 0;
+    for(int op = 1; op <= ops; op++) {
+        int rows = graph.deltaRows();
+        int leftLimit = graph.vertexCount(BipartiteGraph::LEFT) + spread;
+        int rightLimit = graph.vertexCount(BipartiteGraph::RIGHT) + spread;
+        unsigned int kind = random() % 20;
+
+        if(kind < 11 || edges.empty()) {
+            // Repeat an existing edge now and then
+            std::pair<int, int> edge(random() % leftLimit, random() % rightLimit);
+            if(kind == 0 && !edges.empty()) edge = edges[random() % edges.size()];
+            graph.add_edge(edge.first, edge.second);
+            edges.push_back(edge);
+        } else if(kind < 18) {
+            size_t i = random() % edges.size();
+            CHECK(graph.remove_edge(edges[i].first, edges[i].second));
+            removeAt(edges, i);
+        } else if(kind == 18) {
+            // An edge that is not there, the graph is left as it was
+            int left = random() % leftLimit, right = random() % rightLimit;
+            bool present = std::find(edges.begin(), edges.end(), std::make_pair(left, right)) != edges.end();
+            if(!present) CHECK(!graph.remove_edge(left, right));
+        } else {
+            bool fromLeft = random() % 2;
+            BipartiteGraph::Side side = fromLeft ? BipartiteGraph::LEFT : BipartiteGraph::RIGHT;
+            int vertex = random() % graph.vertexCount(side);
+            graph.clear_vertex(side, vertex);
+            for(size_t i = edges.size(); i-- > 0;) {
+                if((fromLeft ? edges[i].first : edges[i].second) == vertex) removeAt(edges, i);
+            }
+        }
+
+        // A compaction empties the delta rows
+        if(graph.deltaRows() < rows) {
+            CHECK(graph.deltaRows() == 0);
+            automatic++;
+        }
+        if(forceEvery && op % forceEvery == 0) {
+            graph.compact();
+            CHECK(graph.deltaRows() == 0);
+        }
+        if(op % 250 == 0) checkGraph(graph, edges);
+    }
+    checkGraph(graph, edges);
+    if(!forceEvery) CHECK(automatic > 0);
+}
+
+int main() {
+    std::mt19937 random(42);
+
+    // Built in two passes, then edited with and without forced compactions
+    {
+        BipartiteGraph graph;
+        Edges edges;
+        int leftCount = 400, rightCount = 300;
+        for(int i = 0; i < 3000; i++) edges.emplace_back(random() % leftCount, random() % rightCount);
+        graph.begin_count(leftCount, rightCount);
+        for(const auto& edge : edges) graph.count_edge(edge.first, edge.second);
+        graph.begin_fill();
+        for(const auto& edge : edges) graph.fill_edge(edge.first, edge.second);
+        graph.end_fill();
+        checkGraph(graph, edges);
+
+        randomEdits(graph, edges, random, 6000, 0, 20);
+        randomEdits(graph, edges, random, 3000, 97, 20);
+        graph.compact();
+        checkGraph(graph, edges);
+    }
+
+    // Adopted arrays are only read, edits and compactions leave them alone.
+    // Filling them in edge order keeps every row sorted, as adopt() needs
+    {
+        int leftCount = 50, rightCount = 40;
+        Edges edges;
+        for(int i = 0; i < 300; i++) edges.emplace_back(random() % leftCount, random() % rightCount);
+        std::sort(edges.begin(), edges.end());
+        std::vector<uint64_t> leftOffsets(leftCount + 1), rightOffsets(rightCount + 1);
+        for(const auto& edge : edges) {
+            leftOffsets[edge.first + 1]++;
+            rightOffsets[edge.second + 1]++;
+        }
+        for(int v = 0; v < leftCount; v++) leftOffsets[v + 1] += leftOffsets[v];
+        for(int v = 0; v < rightCount; v++) rightOffsets[v + 1] += rightOffsets[v];
+        std::vector<int> leftNeighbours(edges.size()), rightNeighbours(edges.size());
+        std::vector<uint64_t> leftFill(leftOffsets), rightFill(rightOffsets);
+        for(const auto& edge : edges) {
+            leftNeighbours[leftFill[edge.first]++] = edge.second;
+            rightNeighbours[rightFill[edge.second]++] = edge.first;
+        }
+        const std::vector<int> leftCopy(leftNeighbours), rightCopy(rightNeighbours);
+
+        BipartiteGraph graph;
+        graph.adopt(leftCount, leftOffsets.data(), leftNeighbours.data(),
+                    rightCount, rightOffsets.data(), rightNeighbours.data());
+        checkGraph(graph, edges);
+        randomEdits(graph, edges, random, 2000, 301, 5);
+        CHECK(leftNeighbours == leftCopy && rightNeighbours == rightCopy);
+    }
+
+    // Every vertex reached only through edits, past an empty CSR range
+    {
+        BipartiteGraph graph;
+        Edges edges;
+        randomEdits(graph, edges, random, 4000, 0, 3);
+        CHECK(graph.vertexCount(BipartiteGraph::LEFT) > 0);
+    }
+
+    return report("bipartitegraph");
+}
@@ -0,0 +1,24 @@
+// The harness every tests/*.cpp program shares. CHECK records a failed
+// condition and carries on, so one run lists every failure, and report()
+// prints the program's result line and returns its exit code
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                   \
+    do {                                                                   \
+        if(!(condition)) {                                                 \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                    \
+        }                                                                  \
+    } while(0)
+
+static int report(const char* name) {
+    printf("%s: %s\n", name, failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+#endif // TESTS_CHECK_H
@@ -0,0 +1,61 @@
+// Every string type must hash the same text the same way, so maps keyed by
+// std::string can be searched with any of them (see dst/hash.h)
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "dst/flathashmap.h"
+#include "dst/hash.h"
+#include "dst/hashmap.h"
+
+#include "check.h"
+
+template<typename Hash>
+static void checkStringTypes(const char* text) {
+    char buffer[64];
+    strcpy(buffer, text);
+    std::string string(text);
+    unsigned int expected = Hash::hash(string);
+
+    CHECK(Hash::hash(std::string_view(text)) == expected);
+    CHECK(Hash::hash(static_cast<const char*>(buffer)) == expected);
+    CHECK(Hash::hash(static_cast<char*>(buffer)) == expected);
+    CHECK(Hash::hash(text) == expected);
+
+    // Copies of the text at other addresses, char arrays decay to pointers
+    char other[64];
+    strcpy(other, text);
+    CHECK(Hash::hash(other) == expected);
+}
+
+template<typename Map>
+static void checkLookups() {
+    Map map;
+    map.insert(std::string("hello"), 1);
+    map.insert(std::string("world"), 2);
+
+    char buffer[] = "hello";
+    CHECK(map.get(static_cast<char*>(buffer)) != nullptr && *map.get(static_cast<char*>(buffer)) == 1);
+    CHECK(map.get(static_cast<const char*>(buffer)) != nullptr);
+    CHECK(map.get(std::string_view("world")) != nullptr && *map.get(std::string_view("world")) == 2);
+    CHECK(map.get(buffer) != nullptr);
+    CHECK(map.get("missing") == nullptr);
+}
+
+int main() {
+    const char* texts[] = {"", "hello", "Tom Jansen", "a longer key with spaces and punctuation!"};
+    for(const char* text : texts) {
+        checkStringTypes<IdentityHash>(text);
+        checkStringTypes<MixedHash>(text);
+    }
+
+    // Non-string keys keep their own overloads
+    CHECK(IdentityHash::hash(42) == 42u);
+    CHECK(MixedHash::hash(42) == mixHash(42u));
+
+    checkLookups<HashMap<std::string, int>>();
+    checkLookups<FlatHashMap<std::string, int>>();
+
+    return report("hash");
+}
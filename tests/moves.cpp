@@ -0,0 +1,255 @@
+// Moving a container hands over its storage: the entries and pointers into
+// them survive, and the moved-from container is empty but still usable.
+// SmallVector (see dst/smallvector.h) is covered in both of its states, and
+// a copy of one owns its own elements
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "dst/bplustree.h"
+#include "dst/flathashmap.h"
+#include "dst/hashmap.h"
+#include "dst/smallvector.h"
+
+#include "check.h"
+
+// Four elements inline, a fifth moves them to the heap
+typedef SmallVector<int, 4> Row;
+
+static Row make(int from, int count) {
+    Row row;
+    for(int i = from; i < from + count; i++) row.push_back(i);
+    return row;
+}
+
+static bool holds(const Row& row, int from, int count) {
+    if(row.getSize() != count) return false;
+    for(int i = 0; i < count; i++) {
+        if(row[i] != from + i) return false;
+    }
+    return true;
+}
+
+static void checkGrowth() {
+    Row row = make(0, 4);
+    CHECK(holds(row, 0, 4) && row.heapBytes() == 0);
+    row.push_back(4);
+    CHECK(holds(row, 0, 5) && row.heapBytes() > 0);
+
+    // reserve moves the inline elements to the heap, then grows in place
+    Row reserved = make(10, 3);
+    reserved.reserve(16);
+    CHECK(holds(reserved, 10, 3) && reserved.heapBytes() == 16 * sizeof(int));
+    reserved.reserve(8);
+    CHECK(reserved.heapBytes() == 16 * sizeof(int));
+    for(int i = 13; i < 40; i++) reserved.push_back(i);
+    CHECK(holds(reserved, 10, 30));
+}
+
+// remove() takes the first copy, from either end, in either state
+static void checkRemove() {
+    for(int count : {4, 9}) {
+        Row row = make(0, count);
+        CHECK(row.remove(0) && holds(row, 1, count - 1));
+        CHECK(row.remove(count - 1) && holds(row, 1, count - 2));
+        CHECK(!row.remove(count));
+    }
+}
+
+// insert() and erase() at either end and in the middle, the inserts
+// crossing from inline storage to the heap
+static void checkInsertErase() {
+    Row row;
+    row.insert(0, 2);
+    row.insert(0, 1);
+    row.insert(2, 4);
+    row.insert(2, 3);
+    CHECK(holds(row, 1, 4) && row.heapBytes() == 0);
+    row.insert(0, 0);
+    row.insert(5, 6);
+    row.insert(5, 5);
+    CHECK(holds(row, 0, 7) && row.heapBytes() > 0);
+
+    row.erase(0);
+    CHECK(holds(row, 1, 6));
+    row.erase(row.getSize() - 1);
+    CHECK(holds(row, 1, 5));
+    row.erase(2);
+    CHECK(row.getSize() == 4 && row[1] == 2 && row[2] == 4);
+    while(!row.empty()) row.erase(row.getSize() - 1);
+    row.insert(0, 9);
+    CHECK(row.getSize() == 1 && row[0] == 9);
+
+    Row small = make(0, 3);
+    small.erase(0);
+    small.erase(small.getSize() - 1);
+    CHECK(holds(small, 1, 1));
+}
+
+static void checkCopies() {
+    for(int count : {3, 9}) {
+        Row source = make(0, count);
+        Row copy(source);
+        CHECK(holds(copy, 0, count));
+        CHECK(copy.begin() != source.begin());
+        source[0] = -1;
+        CHECK(holds(copy, 0, count));
+    }
+
+    // Assignment between every pair of states, including to itself
+    for(int from : {3, 9}) {
+        for(int to : {2, 12}) {
+            Row source = make(100, from);
+            Row target = make(0, to);
+            target = source;
+            CHECK(holds(target, 100, from) && holds(source, 100, from));
+            CHECK(target.begin() != source.begin());
+        }
+    }
+    Row self = make(0, 9);
+    Row& alias = self;
+    self = alias;
+    CHECK(holds(self, 0, 9));
+}
+
+static void checkMoves() {
+    // From inline storage the elements are copied over
+    Row inlineSource = make(0, 3);
+    Row fromInline(std::move(inlineSource));
+    CHECK(holds(fromInline, 0, 3) && fromInline.heapBytes() == 0);
+    CHECK(inlineSource.empty());
+
+    // From the heap the array itself changes hands
+    Row heapSource = make(0, 9);
+    const int* array = heapSource.begin();
+    Row fromHeap(std::move(heapSource));
+    CHECK(holds(fromHeap, 0, 9) && fromHeap.begin() == array);
+    CHECK(heapSource.empty() && heapSource.heapBytes() == 0);
+
+    // The moved-from vector takes new elements, back to the heap too
+    for(int i = 0; i < 6; i++) heapSource.push_back(i);
+    CHECK(holds(heapSource, 0, 6));
+
+    for(int from : {3, 9}) {
+        for(int to : {2, 12}) {
+            Row source = make(100, from);
+            Row target = make(0, to);
+            target = std::move(source);
+            CHECK(holds(target, 100, from));
+            CHECK(source.empty() && source.heapBytes() == 0);
+            source.push_back(7);
+            CHECK(source.getSize() == 1 && source[0] == 7);
+        }
+    }
+    Row self = make(0, 9);
+    Row& alias = self;
+    self = std::move(alias);
+    CHECK(holds(self, 0, 9));
+}
+
+// FlatHashMap's backward-shift remove moves rows one slot back, the way the
+// cast graph keeps its edited rows. Rows of every length must survive it
+static void checkMapRows() {
+    FlatHashMap<int, Row> rows;
+    const int keys = 2000;
+    for(int key = 0; key < keys; key++) rows.insert(key, make(key, key % 11));
+    for(int key = 0; key < keys; key += 3) rows.remove(key);
+
+    int wrong = 0;
+    for(int key = 0; key < keys; key++) {
+        Row* row = rows.get(key);
+        if(key % 3 == 0) wrong += row != nullptr;
+        else wrong += row == nullptr || !holds(*row, key, key % 11);
+    }
+    CHECK(wrong == 0);
+}
+
+static const int COUNT = 1000;
+
+template<typename Map>
+static void fill(Map& map, int from) {
+    for(int i = from; i < from + COUNT; i++) map.insert(i, std::to_string(i));
+}
+
+template<typename Map>
+static bool holds(Map& map, int from) {
+    if(map.getSize() != COUNT) return false;
+    for(int i = from; i < from + COUNT; i++) {
+        std::string* value = map.get(i);
+        if(value == nullptr || *value != std::to_string(i)) return false;
+    }
+    return true;
+}
+
+template<typename Map>
+static void checkMap() {
+    Map source;
+    fill(source, 0);
+    std::string* first = source.get(0);
+
+    Map moved(std::move(source));
+    CHECK(holds(moved, 0));
+    CHECK(moved.get(0) == first);
+    CHECK(source.getSize() == 0 && source.get(0) == nullptr);
+
+    // The moved-from map takes inserts and grows again
+    fill(source, COUNT);
+    CHECK(holds(source, COUNT));
+
+    // Assignment drops the old entries and takes the other map's
+    moved = std::move(source);
+    CHECK(holds(moved, COUNT));
+    CHECK(moved.get(0) == nullptr);
+    CHECK(source.getSize() == 0);
+    source.insert(-1, "back");
+    CHECK(source.get(-1) != nullptr && *source.get(-1) == "back");
+
+    moved = std::move(moved);
+    CHECK(holds(moved, COUNT));
+}
+
+// A HashMap moved halfway through an incremental resize carries the old
+// bucket array along and finishes migrating it. The table doubles to 2048
+// at entry 768, so 1000 inserts leave part of the old table to move
+static void checkIncrementalResize() {
+    HashMap<int, std::string> source(16, true);
+    fill(source, 0);
+    HashMap<int, std::string> moved(std::move(source));
+    for(int i = COUNT; i < 2 * COUNT; i++) moved.remove(i);
+    CHECK(holds(moved, 0));
+}
+
+static void checkTree() {
+    BPlusTree<int, std::string> source;
+    for(int i = 0; i < COUNT; i++) source.insert(i, std::to_string(i));
+    std::string* first = source.search(0);
+
+    BPlusTree<int, std::string> moved(std::move(source));
+    CHECK(moved.search(0) == first);
+    CHECK(moved.search(COUNT - 1) != nullptr && *moved.search(COUNT - 1) == std::to_string(COUNT - 1));
+    CHECK(source.search(0) == nullptr);
+
+    source.insert(COUNT, "next");
+    moved = std::move(source);
+    CHECK(moved.search(0) == nullptr);
+    CHECK(moved.search(COUNT) != nullptr && *moved.search(COUNT) == "next");
+    CHECK(source.search(COUNT) == nullptr);
+    source.insert(1, "one");
+    CHECK(source.search(1) != nullptr && *source.search(1) == "one");
+}
+
+int main() {
+    checkGrowth();
+    checkRemove();
+    checkInsertErase();
+    checkCopies();
+    checkMoves();
+    checkMapRows();
+
+    checkMap<HashMap<int, std::string>>();
+    checkMap<FlatHashMap<int, std::string>>();
+    checkIncrementalResize();
+    checkTree();
+
+    return report("moves");
+}
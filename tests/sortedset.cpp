@@ -0,0 +1,146 @@
+// Every intersection path of algs/sortedset.h against a scalar reference:
+// the SSE2 block compare, galloping, the plain merge, and the choice
+// sorted_intersect makes between them. Inputs cover empty arrays, sizes
+// that are not multiples of the block size of 4, repeated values and both
+// sides of the galloping threshold
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "algs/sortedset.h"
+
+#include "check.h"
+
+typedef std::vector<int> Values;
+
+// Distinct values present in both, ascending
+static Values reference(const Values& a, const Values& b) {
+    Values both;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(both));
+    both.erase(std::unique(both.begin(), both.end()), both.end());
+    return both;
+}
+
+// Runs one intersection with room for exactly the smaller input, plus
+// guard values that must come back untouched
+template<typename Intersect>
+static Values run(Intersect intersect, const Values& a, const Values& b) {
+    const int GUARD = 4, MARK = -12345;
+    Values out(std::min(a.size(), b.size()) + GUARD, MARK);
+    int count = intersect(a.data(), static_cast<int>(a.size()), b.data(), static_cast<int>(b.size()), out.data());
+    bool untouched = count >= 0 && static_cast<size_t>(count) <= out.size() - GUARD;
+    for(size_t i = out.size() - GUARD; i < out.size(); i++) untouched = untouched && out[i] == MARK;
+    CHECK(untouched);
+    out.resize(untouched ? count : 0);
+    return out;
+}
+
+static int merge(const int* a, int aSize, const int* b, int bSize, int* out) {
+    return intersect_merge(a, aSize, b, bSize, out, 0);
+}
+
+// Every path agrees with the reference, on (a, b) and on (b, a)
+static bool agrees(const Values& a, const Values& b) {
+    Values expected = reference(a, b);
+    bool same = run(sorted_intersect, a, b) == expected && run(sorted_intersect, b, a) == expected;
+    same = same && run(merge, a, b) == expected;
+    if(!a.empty()) same = same && run(intersect_gallop, a, b) == expected;
+#if defined(__SSE2__)
+    same = same && run(intersect_sse2, a, b) == expected && run(intersect_sse2, b, a) == expected;
+#endif
+    return same;
+}
+
+// size ascending values out of range consecutive ones from -range / 4,
+// repeats likely when range is small
+static Values randomValues(std::mt19937& random, int size, int range) {
+    Values values(size);
+    for(int& value : values) value = static_cast<int>(random() % range) - range / 4;
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+static void checkSmallSizes(std::mt19937& random) {
+    // Every pair of sizes up to three blocks and a tail, empty included
+    int wrong = 0;
+    for(int aSize = 0; aSize <= 13; aSize++) {
+        for(int bSize = 0; bSize <= 13; bSize++) {
+            for(int range : {4, 16, 64}) {
+                for(int trial = 0; trial < 20; trial++) {
+                    wrong += !agrees(randomValues(random, aSize, range), randomValues(random, bSize, range));
+                }
+            }
+        }
+    }
+    CHECK(wrong == 0);
+}
+
+static void checkRepeats() {
+    // Runs of one value crossing block boundaries, on one side or both
+    CHECK(agrees(Values(9, 5), Values(7, 5)));
+    CHECK(agrees(Values(9, 5), Values{1, 2, 3, 4, 5, 5, 5, 5, 5, 6}));
+    CHECK(agrees(Values{1, 1, 1, 2, 2, 3, 3, 3, 3, 4, 4}, Values{0, 1, 3, 3, 4, 4, 4, 4, 4, 4, 8}));
+    CHECK(agrees(Values{3, 3, 3, 3, 7, 7, 7, 7}, Values{3, 7}));
+
+    // Identical and disjoint inputs
+    Values same{-8, -2, 0, 4, 9, 10, 11, 40, 41};
+    CHECK(agrees(same, same));
+    CHECK(agrees(Values{0, 2, 4, 6, 8, 10}, Values{1, 3, 5, 7, 9, 11}));
+    CHECK(agrees(Values{0, 1, 2, 3, 4}, Values{5, 6, 7, 8, 9}));
+}
+
+static void checkGallopThreshold(std::mt19937& random) {
+    // sorted_intersect gallops once the longer side is 32 times the
+    // shorter: 95 / 3 stays on the block compare, 96 / 3 gallops
+    int wrong = 0;
+    for(int aSize : {1, 2, 3, 5}) {
+        for(int bSize : {aSize * 32 - 1, aSize * 32, aSize * 32 + 3, aSize * 200}) {
+            for(int trial = 0; trial < 50; trial++) {
+                Values b = randomValues(random, bSize, bSize * 2);
+                Values a = randomValues(random, aSize, bSize * 2);
+                // Make sure some values are shared, at the ends too
+                if(trial % 2) a[0] = b[random() % bSize];
+                if(trial % 3 == 0) a[aSize - 1] = b[bSize - 1];
+                std::sort(a.begin(), a.end());
+                wrong += !agrees(a, b);
+            }
+        }
+    }
+    CHECK(wrong == 0);
+}
+
+static void checkSearches(std::mt19937& random) {
+    int wrong = 0;
+    for(int trial = 0; trial < 200; trial++) {
+        Values values = randomValues(random, static_cast<int>(random() % 40), 30);
+        const int* first = values.data();
+        const int* last = first + values.size();
+        for(int value = -10; value < 30; value++) {
+            wrong += gallop_lower_bound(first, last, value) != std::lower_bound(first, last, value);
+            wrong += sorted_contains(first, last, value) != std::binary_search(first, last, value);
+        }
+    }
+    CHECK(wrong == 0);
+}
+
+static void checkLarge(std::mt19937& random) {
+    int wrong = 0;
+    for(int trial = 0; trial < 100; trial++) {
+        int aSize = static_cast<int>(random() % 500), bSize = static_cast<int>(random() % 500);
+        wrong += !agrees(randomValues(random, aSize, 800), randomValues(random, bSize, 800));
+    }
+    CHECK(wrong == 0);
+}
+
+int main() {
+    std::mt19937 random(25);
+    checkSmallSizes(random);
+    checkRepeats();
+    checkGallopThreshold(random);
+    checkSearches(random);
+    checkLarge(random);
+
+    return report("sortedset");
+}